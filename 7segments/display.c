@@ -0,0 +1,128 @@
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "display.h"
+
+
+static int map(struct display * display, off_t offset)
+{
+    void * memory;
+
+    memory = mmap(NULL, DISPLAY_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, display->fd, offset);
+    if (memory == MAP_FAILED) {
+        close(display->fd);
+        display->fd = -1;
+        return -1;
+    }
+    display->gpio = memory;
+    return 0;
+}
+
+
+/**
+ * The FPGA registers of the APF27, through /dev/mem.
+ */
+static int mem_map(struct display * display, const char * arg)
+{
+    display->fd = open(arg != NULL ? arg : "/dev/mem", O_RDWR);
+    if (display->fd < 0) {
+        return -1;
+    }
+    return map(display, DISPLAY_BASE);
+}
+
+static const struct display_backend mem = {
+    "mem", "the registers of the APF27, mapped from /dev/mem",
+    mem_map,
+};
+
+
+int display_map_shared(struct display * display, const char * path)
+{
+    struct stat st;
+
+    display->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (display->fd < 0) {
+        return -1;
+    }
+    // Whoever comes first sizes it, the registers reading as zeroes
+    if (fstat(display->fd, &st) < 0 || (st.st_size < DISPLAY_SIZE && ftruncate(display->fd, DISPLAY_SIZE) < 0)) {
+        close(display->fd);
+        display->fd = -1;
+        return -1;
+    }
+    return map(display, 0);
+}
+
+
+/**
+ * A shared file standing for the registers, for seg7sampler to watch.
+ */
+static int sim_map(struct display * display, const char * arg)
+{
+    return display_map_shared(display, arg != NULL ? arg : DISPLAY_SIM_PATH);
+}
+
+static const struct display_backend sim = {
+    "sim", "a shared file watched by seg7sampler (default " DISPLAY_SIM_PATH ")",
+    sim_map,
+};
+
+
+const uint16_t display_selects[DISPLAY_DIGITS] = {
+    DISPLAY_SELECT_DIGIT(0),
+    DISPLAY_SELECT_DIGIT(1),
+};
+
+
+const struct display_backend * const display_backends[] = {
+    &mem,
+    &sim,
+    NULL,
+};
+
+
+int display_open(struct display * display, const char * spec)
+{
+    const char * arg = NULL;
+    size_t length;
+    int i;
+
+    memset(display, 0, sizeof(*display));
+    display->fd = -1;
+
+    if (spec == NULL || *spec == '\0') {
+        spec = display_backends[0]->name;
+    }
+    length = strcspn(spec, ":");
+    if (spec[length] == ':') {
+        arg = spec + length + 1;
+    }
+
+    for (i = 0; display_backends[i] != NULL; i++) {
+        if (strlen(display_backends[i]->name) == length
+                && strncmp(display_backends[i]->name, spec, length) == 0) {
+            display->backend = display_backends[i];
+            return display->backend->map(display, arg);
+        }
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+
+void display_close(struct display * display)
+{
+    if (display->gpio != NULL) {
+        munmap((void *)display->gpio, DISPLAY_SIZE);
+        display->gpio = NULL;
+    }
+    if (display->fd >= 0) {
+        close(display->fd);
+        display->fd = -1;
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * Where the registers of the 7-segment display live. On the APF27 they
+ * are mapped from /dev/mem. Off target, the simulated backend maps a
+ * shared file instead, in which seg7sampler watches the writes of the
+ * refresh code: the variants run, and are measured, on any Linux box.
+ *
+ * A display is opened from a spec, "mem" or "sim[:PATH]", usually taken
+ * from the DISPLAY_ENV environment variable.
+ */
+
+#define DISPLAY_ENV "SEG7_DISPLAY"
+
+// Physical address of the FPGA registers on the APF27
+#define DISPLAY_BASE 0xd6000000
+#define DISPLAY_SIZE 256
+
+// Default shared file of the simulated backend
+#define DISPLAY_SIM_PATH "/dev/shm/seg7"
+
+// seg7_rw: one select bit per digit, the segments and the dot above
+#define DISPLAY_DIGITS 2
+#define DISPLAY_SELECT 0x003
+#define DISPLAY_SEGMENTS 0x3fc
+
+// Select bit of a digit below DISPLAY_DIGITS, the units being digit 0
+#define DISPLAY_SELECT_DIGIT(digit) (1 << (digit))
+
+
+/**
+ * 7-segment display and LED interface
+ */
+struct gpio_ctrl {
+    uint16_t reserved1[(0x08-0x00)/2];
+    uint16_t seg7_rw;
+    uint16_t seg7_ctrl;
+    uint16_t seg7_id;
+    uint16_t reserved2[1];
+    uint16_t leds_rw;
+    uint16_t leds_ctrl;
+    uint16_t leds_id;
+};
+
+struct display;
+
+/**
+ * A backend. map() sets display->gpio up from the argument of the spec,
+ * NULL if it has none, and returns -1 with errno set on failure.
+ */
+struct display_backend {
+    const char * name;
+    const char * description;
+    int (*map)(struct display * display, const char * arg);
+};
+
+struct display {
+    const struct display_backend * backend;
+    volatile struct gpio_ctrl * gpio;
+    int fd;
+};
+
+
+/**
+ * The select words of the digits of the APF27, the units first, as
+ * encoder_init() takes them.
+ */
+extern const uint16_t display_selects[DISPLAY_DIGITS];
+
+/**
+ * Every available backend, NULL terminated, the default first.
+ */
+extern const struct display_backend * const display_backends[];
+
+/**
+ * Maps the registers of the display the spec names, the default backend
+ * if it is NULL or empty. Returns -1 with errno set on failure, EINVAL if
+ * there is no such backend.
+ */
+int display_open(struct display * display, const char * spec);
+
+/**
+ * Unmaps the registers.
+ */
+void display_close(struct display * display);
+
+/**
+ * Maps the shared file of the simulated backend, creating it if needed,
+ * as seg7sampler does to watch it. Returns -1 with errno set on failure.
+ */
+int display_map_shared(struct display * display, const char * path);
+
+#endif
@@ -0,0 +1,82 @@
+#include <stdlib.h>
+#include <errno.h>
+
+#include "frame.h"
+#include "encoder.h"
+
+
+int encoder_init(struct encoder * encoder, const uint16_t * glyphs, unsigned int base,
+        const uint16_t * selects, unsigned int digits, uint16_t negative)
+{
+    unsigned long values = 1, count;
+    unsigned int magnitude, i;
+    uint16_t used = negative;
+    uint16_t * words;
+    uint16_t sign;
+    int value;
+
+    if (base < 2 || digits == 0 || digits > FRAME_DIGITS) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (i = 0; i < digits; i++) {
+        values *= base;
+        if (values > ENCODER_MAX_FRAMES) {
+            errno = ERANGE;
+            return -1;
+        }
+    }
+    count = negative != 0 ? 2 * values - 1 : values;
+    if (count > ENCODER_MAX_FRAMES) {
+        errno = ERANGE;
+        return -1;
+    }
+
+    for (i = 0; i < base; i++) {
+        used |= glyphs[i];
+    }
+    // Select bits on the segments would light a digit with the wrong ones
+    for (i = 0; i < digits; i++) {
+        if (selects[i] == 0 || (selects[i] & used) != 0) {
+            errno = EINVAL;
+            return -1;
+        }
+        used |= selects[i];
+    }
+
+    // One more, blank, for the values out of range
+    encoder->frames = calloc((count + 1) * digits, sizeof(*encoder->frames));
+    if (encoder->frames == NULL) {
+        return -1;
+    }
+    encoder->digits = digits;
+    encoder->max = values - 1;
+    encoder->min = negative != 0 ? -encoder->max : 0;
+
+    words = encoder->frames;
+    for (value = encoder->min; value <= encoder->max; value++) {
+        magnitude = value < 0 ? -value : value;
+        sign = value < 0 ? negative : 0;
+        for (i = 0; i < digits; i++) {
+            *words++ = glyphs[magnitude % base] | selects[i] | sign;
+            magnitude /= base;
+        }
+    }
+    return 0;
+}
+
+
+void encoder_destroy(struct encoder * encoder)
+{
+    free(encoder->frames);
+    encoder->frames = NULL;
+}
+
+
+const uint16_t * encoder_frame(const struct encoder * encoder, int value)
+{
+    if (value < encoder->min || value > encoder->max) {
+        value = encoder->max + 1;
+    }
+    return encoder->frames + (value - encoder->min) * encoder->digits;
+}
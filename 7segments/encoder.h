@@ -0,0 +1,60 @@
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <stdint.h>
+
+
+/**
+ * Frame encoder: the seg7_rw words of every digit, for every value the
+ * display can show, computed once at startup. Showing a value is then a
+ * single table lookup, without the divisions and branches of splitting
+ * it into digits, which the ARM926 has no instruction for.
+ *
+ * A value is written in base base, one glyph per digit, the least
+ * significant digit first (digit 0) and leading zeros shown. The glyphs
+ * are the segments of every digit value, the usual seg_7[] table giving
+ * decimal (base 10) or hexadecimal (base 16), any other table custom
+ * symbols. Negative values are shown by their magnitude with the negative
+ * segments added to every digit, e.g. SEG_DOT, if there are any.
+ *
+ * Where a digit is selected depends on how the display is wired: the
+ * caller gives the select word of every digit, display_selects[] on the
+ * APF27, which must not share bits with the glyphs, the negative segments
+ * or one another. Any number of digits up to FRAME_DIGITS, as long as the
+ * table stays below ENCODER_MAX_FRAMES frames (four decimal or hex
+ * digits, eight binary ones).
+ */
+
+#define ENCODER_MAX_FRAMES 65536
+
+
+struct encoder {
+    unsigned int digits;
+    int min;                // Values with a frame of their own
+    int max;
+    uint16_t * frames;      // digits words per value from min, a blank frame last
+};
+
+
+/**
+ * Builds the frames of digits digits of base glyphs, selected by the
+ * words of selects, signed values too if negative is not 0. Returns -1
+ * with errno set on failure, EINVAL if base is below 2, digits is 0 or
+ * above FRAME_DIGITS, or a select word is 0 or overlaps the segments or
+ * another one, ERANGE if the table would be too large.
+ */
+int encoder_init(struct encoder * encoder, const uint16_t * glyphs, unsigned int base,
+        const uint16_t * selects, unsigned int digits, uint16_t negative);
+
+/**
+ * Frees the frames.
+ */
+void encoder_destroy(struct encoder * encoder);
+
+/**
+ * Returns the words of the digits showing value, those of a blank
+ * display if it cannot be shown.
+ */
+const uint16_t * encoder_frame(const struct encoder * encoder, int value);
+
+#endif
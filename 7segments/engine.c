@@ -0,0 +1,79 @@
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+
+#include "engine.h"
+
+
+void * engine_run(void * arg)
+{
+    struct engine * engine = arg;
+    unsigned int slot;
+
+    while (!engine->done) {
+        slot = refresh_wait(&engine->refresh);
+        if (slot == 0) {
+            // Busy writer, the previous frame is as consistent
+            frame_read(&engine->frame, engine->shown, engine->refresh.slots);
+        }
+        engine->gpio->seg7_rw = engine->shown[slot];
+    }
+    return NULL;
+}
+
+
+int engine_init(struct engine * engine, volatile struct gpio_ctrl * gpio,
+        const struct refresh_policy * policy, unsigned int digits, long period)
+{
+    memset(engine, 0, sizeof(*engine));
+    engine->gpio = gpio;
+    frame_init(&engine->frame);
+    if (policy == NULL) {
+        policy = refresh_policy_find(ENGINE_POLICY);
+    }
+    return refresh_init(&engine->refresh, policy, digits, period);
+}
+
+
+void engine_close(struct engine * engine)
+{
+    refresh_close(&engine->refresh);
+}
+
+
+int engine_start(struct engine * engine, volatile struct gpio_ctrl * gpio,
+        const struct refresh_policy * policy, unsigned int digits, long period)
+{
+    sigset_t all, previous;
+    int ret;
+
+    if (engine_init(engine, gpio, policy, digits, period) < 0) {
+        return -1;
+    }
+
+    // Signals are for the other threads, the refresh is never interrupted
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &previous);
+    ret = pthread_create(&engine->thread, NULL, engine_run, engine);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (ret != 0) {
+        engine_close(engine);
+        errno = ret;
+        return -1;
+    }
+    return 0;
+}
+
+
+void engine_publish(struct engine * engine, const uint16_t * words)
+{
+    frame_write(&engine->frame, words, engine->refresh.slots);
+}
+
+
+void engine_stop(struct engine * engine)
+{
+    engine->done = 1;
+    pthread_join(engine->thread, NULL);
+    engine_close(engine);
+}
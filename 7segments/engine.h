@@ -0,0 +1,78 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "display.h"
+#include "frame.h"
+#include "refresh.h"
+
+
+/**
+ * Refresh engine: a thread of its own multiplexes the digits, writing the
+ * seg7_rw word of one digit per slot of a refresh schedule, by default
+ * the periodic timerfd one. Nothing runs in signal context, and whoever
+ * decides what is displayed only calls engine_publish() when it changes,
+ * sleeping in between.
+ *
+ * The thread takes the frame published last at the start of every turn of
+ * the digits, so that a turn never mixes two numbers.
+ *
+ * Variants running the refresh on a thread of their own set the engine up
+ * with engine_init() and call engine_run() from it instead.
+ */
+
+#define ENGINE_POLICY "timerfd"
+
+
+struct engine {
+    volatile struct gpio_ctrl * gpio;
+    struct refresh refresh;
+    struct frame frame;
+    uint16_t shown[FRAME_DIGITS];   // The frame of the current turn
+    volatile int done;              // Set to have engine_run() return
+    pthread_t thread;
+};
+
+
+/**
+ * Sets the refresh of digits digits of the display up, period us each,
+ * the schedule kept by policy, ENGINE_POLICY if NULL. The digits are
+ * blank until shown. Returns -1 with errno set on failure.
+ */
+int engine_init(struct engine * engine, volatile struct gpio_ctrl * gpio,
+        const struct refresh_policy * policy, unsigned int digits, long period);
+
+/**
+ * Refreshes the digits until engine->done is set. A pthread start
+ * routine, engine being its argument.
+ */
+void * engine_run(void * engine);
+
+/**
+ * Releases the schedule, once engine_run() returned.
+ */
+void engine_close(struct engine * engine);
+
+/**
+ * Sets the engine up as engine_init() does, and starts engine_run() on a
+ * thread of its own, with every signal blocked. Returns -1 with errno set
+ * on failure.
+ */
+int engine_start(struct engine * engine, volatile struct gpio_ctrl * gpio,
+        const struct refresh_policy * policy, unsigned int digits, long period);
+
+/**
+ * Publishes the seg7_rw words of every digit, select bits included, which
+ * are shown from the next turn on. Never waits for the thread.
+ */
+void engine_publish(struct engine * engine, const uint16_t * words);
+
+/**
+ * Stops the thread engine_start() started and releases the schedule,
+ * leaving the display as is.
+ */
+void engine_stop(struct engine * engine);
+
+#endif
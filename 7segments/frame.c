@@ -0,0 +1,62 @@
+#include <errno.h>
+
+#include "frame.h"
+
+
+void frame_init(struct frame * frame)
+{
+    unsigned int i;
+
+    frame->sequence = 0;
+    for (i = 0; i < FRAME_DIGITS; i++) {
+        frame->words[i] = 0;
+    }
+    __sync_synchronize();
+}
+
+
+void frame_write(struct frame * frame, const uint16_t * words, unsigned int count)
+{
+    unsigned int i;
+
+    frame->sequence = frame->sequence + 1;
+    // Readers must see the odd sequence before any of the words
+    __sync_synchronize();
+    for (i = 0; i < FRAME_DIGITS; i++) {
+        frame->words[i] = i < count ? words[i] : 0;
+    }
+    // And every word before the sequence is even again
+    __sync_synchronize();
+    frame->sequence = frame->sequence + 1;
+}
+
+
+int frame_read(const struct frame * frame, uint16_t * words, unsigned int count)
+{
+    uint16_t copy[FRAME_DIGITS];
+    unsigned int sequence, i, attempt;
+
+    if (count > FRAME_DIGITS) {
+        count = FRAME_DIGITS;
+    }
+    for (attempt = 0; attempt < FRAME_RETRIES; attempt++) {
+        sequence = frame->sequence;
+        if (sequence & 1) {
+            continue;
+        }
+        __sync_synchronize();
+        for (i = 0; i < count; i++) {
+            copy[i] = frame->words[i];
+        }
+        // The words must be read before checking nothing moved
+        __sync_synchronize();
+        if (frame->sequence == sequence) {
+            for (i = 0; i < count; i++) {
+                words[i] = copy[i];
+            }
+            return 0;
+        }
+    }
+    errno = EAGAIN;
+    return -1;
+}
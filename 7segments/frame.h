@@ -0,0 +1,57 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+
+
+/**
+ * What the display shows: the seg7_rw word of every digit, select bit
+ * included, shared between whoever decides what to display and the
+ * thread refreshing the digits.
+ *
+ * Setting the digits one after the other, the refresh could show some of
+ * the previous number and some of the new one. The words are published
+ * together under a sequence counter instead (a seqlock): the writer makes
+ * it odd while it writes, the reader copies the words and checks that the
+ * counter neither was odd nor moved meanwhile. Neither side takes a lock
+ * nor waits for the other: the writer never retries, and the reader gives
+ * up after FRAME_RETRIES, keeping the consistent frame it had.
+ *
+ * One writer at a time, any number of readers. What is relied on: the
+ * sequence is an aligned 32-bit word, loaded and stored whole, and
+ * __sync_synchronize() orders it against the words, for the older
+ * toolchains and the ARM926. The words themselves are plain halfword
+ * accesses whose atomicity does not matter: a word torn by a concurrent
+ * write is only ever read while the sequence moves, and thrown away.
+ */
+
+#define FRAME_DIGITS 8
+
+// Attempts at reading a frame before keeping the previous one
+#define FRAME_RETRIES 8
+
+
+struct frame {
+    volatile unsigned int sequence;     // Odd while a write is in progress
+    volatile uint16_t words[FRAME_DIGITS];
+};
+
+
+/**
+ * Blanks every digit.
+ */
+void frame_init(struct frame * frame);
+
+/**
+ * Publishes the words of the first count digits, the others being blank.
+ */
+void frame_write(struct frame * frame, const uint16_t * words, unsigned int count);
+
+/**
+ * Copies the words of the first count digits of the last frame published.
+ * Returns -1 with errno set to EAGAIN, words being left untouched, if
+ * writes kept getting in the way.
+ */
+int frame_read(const struct frame * frame, uint16_t * words, unsigned int count);
+
+#endif
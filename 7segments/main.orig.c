@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -8,20 +9,8 @@
 #include <sys/mman.h>
 #include <sys/errno.h> 
 
+#include "display.h"
 
-/**
- * 7-segment display and LED interface
- */
-struct gpio_ctrl {
-    uint16_t reserved1[(0x08-0x00)/2];
-    uint16_t seg7_rw;
-    uint16_t seg7_ctrl;
-    uint16_t seg7_id;
-    uint16_t reserved2[1];
-    uint16_t leds_rw;
-    uint16_t leds_ctrl;
-    uint16_t leds_id;
-};
 
 static volatile struct gpio_ctrl* gpio = 0;
 
@@ -116,21 +105,14 @@ static void seg7_display (int8_t value)
 
 int main(void)
 {
-    int fd, i, j;
-
-    fd=open("/dev/mem", O_RDWR);
-
-    if (fd<0) {
-        printf("Could not open /dev/mem: error=%i\n", fd);
-        return fd;
-    }
-
-    gpio = mmap(0, 256, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0xd6000000);
+    struct display display;
+    int i, j;
 
-    if (gpio == (void *) 0xFFFFFFFF) {
-        printf("mmap failed, error: %i:%s \n",errno,strerror(errno));
+    if (display_open(&display, getenv(DISPLAY_ENV)) < 0) {
+        printf("Could not map the display, error: %i:%s \n",errno,strerror(errno));
         return(-1);
     }
+    gpio = display.gpio;
 
     for (i=0; i<100; i++) {
         for (j=0; j<100; j++){
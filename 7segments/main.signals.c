@@ -11,10 +11,14 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/errno.h>
+#include <time.h>
 
-#include <signal.h>
 #include <sys/time.h>
 
+#include "display.h"
+#include "encoder.h"
+#include "engine.h"
+
 
 #define CHECKERR(val, fmt) {                    \
     if ((val) < 0) {                            \
@@ -29,20 +33,6 @@
 #define SPEED 5
 #define SLEEPFUNC sleepfor
 
-/**
- * 7-segment display and LED interface
- */
-struct gpio_ctrl {
-    uint16_t reserved1[(0x08-0x00)/2];
-    uint16_t seg7_rw;
-    uint16_t seg7_ctrl;
-    uint16_t seg7_id;
-    uint16_t reserved2[1];
-    uint16_t leds_rw;
-    uint16_t leds_ctrl;
-    uint16_t leds_id;
-};
-
 static volatile struct gpio_ctrl* gpio = 0;
 
 /* 7-segment: segment definition
@@ -99,34 +89,21 @@ static void seg7_init()
 }
 
 
+static struct engine engine;
+static struct encoder decimal;
+
 /**
- * Method to display a decimal number on the 7-segment
+ * Method to display a decimal number on the 7-segment, from the next
+ * turn of the digits on, the dot lit if it is negative
  */
 static void seg7_display (int8_t value)
 {
-    uint16_t dot = 0;
-
-    if (value < 0) {
-        value = -value;
-        dot = SEG_DOT;
-    }
-
-    gpio->seg7_rw = seg_7[value % 10] + 0x1 + dot;
-    usleep(8500);
-
-    gpio->seg7_rw = seg_7[value / 10] + 0x2 + dot;
-    usleep(8500);
-    gpio->seg7_rw = 0x02;
+    engine_publish(&engine, encoder_frame(&decimal, value % 100));
 }
 
 
 int count=0;
 
-void timer_handler()
-{
-    seg7_display(count);
-}
-
 void safesleep(long s, long us) {
     int ret;
     struct timespec req, rem;
@@ -194,32 +171,27 @@ void sleepfor(long s, long us) {
 
 int main()
 {
-    int fd;
+    const struct refresh_policy * policy = NULL;
+    struct display display;
     int s, ns;
 
-    struct itimerval timer;
-    struct sigaction sa;
-
-    fd = open("/dev/mem", O_RDWR);
-    CHECKERR(fd, "Could not open /dev/mem");
+    CHECKERR(display_open(&display, getenv(DISPLAY_ENV)), "Could not map the display");
+    gpio = display.gpio;
 
-    gpio = mmap(0, 256, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0xd6000000);
-    if (gpio == (void *) 0xFFFFFFFF) {
-        CHECKERR(-1, "mmap failed");
+    if (getenv(REFRESH_ENV) != NULL) {
+        policy = refresh_policy_find(getenv(REFRESH_ENV));
+        if (policy == NULL) {
+            fprintf(stderr, "Unknown refresh policy %s\n", getenv(REFRESH_ENV));
+            exit(EXIT_FAILURE);
+        }
     }
 
     seg7_init();
+    CHECKERR(encoder_init(&decimal, seg_7, 10, display_selects, DISPLAY_DIGITS, SEG_DOT), "Could not build the frames");
 
-    // Handler registration
-    sigemptyset(&sa.sa_mask);
-    sa.sa_handler = timer_handler;
-    sigaction(SIGALRM, &sa, NULL);
-
-    // Timer setup
-    timer.it_value.tv_sec = timer.it_interval.tv_sec = 0;
-    timer.it_value.tv_usec = 1;
-    timer.it_interval.tv_usec = 18000;
-    setitimer(ITIMER_REAL, &timer, NULL);
+    // The digits are refreshed by the engine thread, main only wakes up to count
+    CHECKERR(engine_start(&engine, gpio, policy, 2, REFRESH_SLOT), "Could not start the refresh");
+    seg7_display(count);
 
     s = SPEED / 10;
     ns = (SPEED % 10) * 100 * 1000;
@@ -227,8 +199,13 @@ int main()
     while (count < 500) {
         sleepfor(s, ns);
         count = (count + 1);
+        seg7_display(count);
         printf("Current value is %d\n", count);
     }
 
+    engine_stop(&engine);
+    refresh_print(stdout, &engine.refresh);
+    encoder_destroy(&decimal);
+
     return EXIT_SUCCESS;
 }
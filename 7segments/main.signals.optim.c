@@ -8,10 +8,14 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/errno.h>
+#include <time.h>
 
-#include <signal.h>
 #include <sys/time.h>
 
+#include "display.h"
+#include "encoder.h"
+#include "engine.h"
+
 
 #define CHECKERR(val, fmt) {                    \
     if ((val) < 0) {                            \
@@ -26,20 +30,6 @@
 #define SPEED 5
 #define SLEEPFUNC sleepfor
 
-/**
- * 7-segment display and LED interface
- */
-struct gpio_ctrl {
-    uint16_t reserved1[(0x08-0x00)/2];
-    uint16_t seg7_rw;
-    uint16_t seg7_ctrl;
-    uint16_t seg7_id;
-    uint16_t reserved2[1];
-    uint16_t leds_rw;
-    uint16_t leds_ctrl;
-    uint16_t leds_id;
-};
-
 static volatile struct gpio_ctrl* gpio = 0;
 
 /* 7-segment: segment definition
@@ -95,27 +85,32 @@ static void seg7_init()
     gpio->seg7_rw = 0;
 }
 
+static struct engine engine;
+static struct encoder decimal;
+
 int count = 0;
 
-void timer_handler()
+/**
+ * Shows count, from the next turn of the digits on
+ */
+static void seg7_show()
 {
-    gpio->seg7_rw = seg_7[count % 10] + 0x1;
-    usleep(8500);
-
-    gpio->seg7_rw = seg_7[count / 10] + 0x2;
-    usleep(8500);
+    engine_publish(&engine, encoder_frame(&decimal, count % 100));
 }
 
-struct timespec spec;
-
 void sleepfor(long s, long us) {
     struct timeval current, end;
+    struct timespec spec;
 
     CHECKERR(gettimeofday(&end, NULL), "Failed to get time");
 
     end.tv_sec += s;
     end.tv_usec += us;
 
+    // Nothing interrupts the sleep any more, it has to be the right length
+    spec.tv_sec = s;
+    spec.tv_nsec = us * 1000;
+
     while (1) {
         nanosleep(&spec, NULL);
         gettimeofday(&current, NULL);
@@ -132,40 +127,38 @@ void sleepfor(long s, long us) {
 
 int main()
 {
-    int fd;
+    const struct refresh_policy * policy = NULL;
+    struct display display;
     int s, ns;
 
-    struct itimerval timer;
-    struct sigaction sa;
-
-    fd = open("/dev/mem", O_RDWR);
-    CHECKERR(fd, "Could not open /dev/mem");
+    CHECKERR(display_open(&display, getenv(DISPLAY_ENV)), "Could not map the display");
+    gpio = display.gpio;
 
-    gpio = mmap(0, 256, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0xd6000000);
-    if (gpio == (void *) 0xFFFFFFFF) {
-        CHECKERR(-1, "mmap failed");
+    if (getenv(REFRESH_ENV) != NULL) {
+        policy = refresh_policy_find(getenv(REFRESH_ENV));
+        if (policy == NULL) {
+            fprintf(stderr, "Unknown refresh policy %s\n", getenv(REFRESH_ENV));
+            exit(EXIT_FAILURE);
+        }
     }
 
-    spec.tv_sec = 1;
-    spec.tv_nsec = 0;
-
     seg7_init();
+    CHECKERR(encoder_init(&decimal, seg_7, 10, display_selects, DISPLAY_DIGITS, 0), "Could not build the frames");
 
-    sigemptyset(&sa.sa_mask);
-    sa.sa_handler = timer_handler;
-    sigaction(SIGALRM, &sa, NULL);
-
-    timer.it_value.tv_sec = timer.it_interval.tv_sec = 0;
-    timer.it_value.tv_usec = 1;
-    timer.it_interval.tv_usec = 18000;
-    setitimer(ITIMER_REAL, &timer, NULL);
+    CHECKERR(engine_start(&engine, gpio, policy, 2, REFRESH_SLOT), "Could not start the refresh");
+    seg7_show();
 
     s = SPEED / 10;
     ns = (SPEED % 10) * 100 * 1000;
 
     while (count++ < 500) {
         SLEEPFUNC(s, ns);
+        seg7_show();
     }
 
+    engine_stop(&engine);
+    refresh_print(stdout, &engine.refresh);
+    encoder_destroy(&decimal);
+
     return EXIT_SUCCESS;
 }
@@ -12,10 +12,16 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/errno.h>
+#include <time.h>
 
 #include <signal.h>
 #include <sys/time.h>
 
+#include "display.h"
+#include "encoder.h"
+#include "engine.h"
+#include "refresh.h"
+
 
 #define CHECKERR(val, fmt) {                    \
     if ((val) < 0) {                            \
@@ -30,20 +36,6 @@
 #define SPEED 5
 #define SLEEPFUNC sleepfor
 
-/**
- * 7-segment display and LED interface
- */
-struct gpio_ctrl {
-    uint16_t reserved1[(0x08-0x00)/2];
-    uint16_t seg7_rw;
-    uint16_t seg7_ctrl;
-    uint16_t seg7_id;
-    uint16_t reserved2[1];
-    uint16_t leds_rw;
-    uint16_t leds_ctrl;
-    uint16_t leds_id;
-};
-
 static volatile struct gpio_ctrl* gpio = 0;
 
 /* 7-segment: segment definition
@@ -100,23 +92,17 @@ static void seg7_init()
 }
 
 
+static struct encoder decimal;
+static struct engine engine;
+
 /**
- * Method to display a decimal number on the 7-segment
+ * Method to display a decimal number on the 7-segment, both digits
+ * published at once for the worker to refresh, the dot lit if it is
+ * negative
  */
 static void seg7_display (int8_t value)
 {
-    uint16_t dot = 0;
-
-    if (value < 0) {
-        value = -value;
-        dot = SEG_DOT;
-    }
-
-    gpio->seg7_rw = seg_7[value % 10] + 0x1 + dot;
-    usleep(8500);
-
-    gpio->seg7_rw = seg_7[value / 10] + 0x2 + dot;
-    usleep(8500);
+    engine_publish(&engine, encoder_frame(&decimal, value % 100));
 }
 
 
@@ -124,9 +110,7 @@ int count=0;
 
 void* worker_func()
 {
-    while (1) {
-        seg7_display(count);
-    }
+    return engine_run(&engine);
 }
 
 void safesleep(long s, long us) {
@@ -196,19 +180,24 @@ void sleepfor(long s, long us) {
 
 int main()
 {
-    int fd;
+    const struct refresh_policy * policy;
+    struct display display;
     int s, ns;
     pthread_t worker;
 
-    fd = open("/dev/mem", O_RDWR);
-    CHECKERR(fd, "Could not open /dev/mem");
+    CHECKERR(display_open(&display, getenv(DISPLAY_ENV)), "Could not map the display");
+    gpio = display.gpio;
 
-    gpio = mmap(0, 256, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0xd6000000);
-    if (gpio == (void *) 0xFFFFFFFF) {
-        CHECKERR(-1, "mmap failed");
+    policy = refresh_policy_find(getenv(REFRESH_ENV));
+    if (policy == NULL) {
+        fprintf(stderr, "Unknown refresh policy %s\n", getenv(REFRESH_ENV));
+        exit(EXIT_FAILURE);
     }
 
     seg7_init();
+    CHECKERR(encoder_init(&decimal, seg_7, 10, display_selects, DISPLAY_DIGITS, SEG_DOT), "Could not build the frames");
+    CHECKERR(engine_init(&engine, gpio, policy, 2, REFRESH_SLOT), "Could not set the refresh up");
+    seg7_display(count);
 
     pthread_create(&worker, NULL, worker_func, NULL);
 
@@ -218,8 +207,15 @@ int main()
     while (count < 100) {
         sleepfor(s, ns);
         count = (count + 1);
+        seg7_display(count);
         printf("Current value is %d\n", count);
     }
 
+    engine.done = 1;
+    pthread_join(worker, NULL);
+    refresh_print(stdout, &engine.refresh);
+    engine_close(&engine);
+    encoder_destroy(&decimal);
+
     return EXIT_SUCCESS;
 }
@@ -12,10 +12,16 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/errno.h>
+#include <time.h>
 
 #include <signal.h>
 #include <sys/time.h>
 
+#include "display.h"
+#include "encoder.h"
+#include "engine.h"
+#include "refresh.h"
+
 
 #define CHECKERR(val, fmt) {                    \
     if ((val) < 0) {                            \
@@ -29,20 +35,6 @@
 // Thents of second (1 = 100ms, 10 = 1s)
 #define SPEED 5
 
-/**
- * 7-segment display and LED interface
- */
-struct gpio_ctrl {
-    uint16_t reserved1[(0x08-0x00)/2];
-    uint16_t seg7_rw;
-    uint16_t seg7_ctrl;
-    uint16_t seg7_id;
-    uint16_t reserved2[1];
-    uint16_t leds_rw;
-    uint16_t leds_ctrl;
-    uint16_t leds_id;
-};
-
 static volatile struct gpio_ctrl* gpio = 0;
 
 /* 7-segment: segment definition
@@ -88,8 +80,7 @@ static const uint16_t seg_7 [] =
     SEG_A                         + SEG_E + SEG_F + SEG_G,  /* F */
 };
 
-int val1 = SEG_A + SEG_B + SEG_C + SEG_D + SEG_E + SEG_F + 0x1,
-    val2 = SEG_A + SEG_B + SEG_C + SEG_D + SEG_E + SEG_F + 0x2;
+static struct engine engine;
 
 void * worker_func()
 {
@@ -97,34 +88,42 @@ void * worker_func()
     gpio->leds_rw = 0;
     gpio->seg7_ctrl = 0x3ff;
 
-    while (1) {
-        gpio->seg7_rw = val1;
-        usleep(8500);
-        gpio->seg7_rw = val2;
-        usleep(8500);
-    }
+    return engine_run(&engine);
 }
 
 int main()
 {
-    int fd, count=0;
+    const struct refresh_policy * policy;
+    struct display display;
+    struct encoder decimal;
+    int count=0;
     pthread_t worker;
 
-    fd = open("/dev/mem", O_RDWR);
-    CHECKERR(fd, "Could not open /dev/mem");
+    CHECKERR(display_open(&display, getenv(DISPLAY_ENV)), "Could not map the display");
+    gpio = display.gpio;
 
-    gpio = mmap(0, 256, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0xd6000000);
-    if (gpio == (void *) 0xFFFFFFFF) {
-        CHECKERR(-1, "mmap failed");
+    policy = refresh_policy_find(getenv(REFRESH_ENV));
+    if (policy == NULL) {
+        fprintf(stderr, "Unknown refresh policy %s\n", getenv(REFRESH_ENV));
+        exit(EXIT_FAILURE);
     }
 
+    CHECKERR(encoder_init(&decimal, seg_7, 10, display_selects, DISPLAY_DIGITS, 0), "Could not build the frames");
+    CHECKERR(engine_init(&engine, gpio, policy, 2, REFRESH_SLOT), "Could not set the refresh up");
+    engine_publish(&engine, encoder_frame(&decimal, 0));
+
     pthread_create(&worker, NULL, worker_func, NULL);
 
     while (count++ < 100) {
         usleep(SPEED * 100 * 1000);
-        val1 = seg_7[count % 10] + 0x1;
-        val2 = seg_7[count / 10] + 0x2;
+        engine_publish(&engine, encoder_frame(&decimal, count % 100));
     }
 
+    engine.done = 1;
+    pthread_join(worker, NULL);
+    refresh_print(stdout, &engine.refresh);
+    engine_close(&engine);
+    encoder_destroy(&decimal);
+
     return EXIT_SUCCESS;
 }
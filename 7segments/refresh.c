@@ -0,0 +1,289 @@
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "refresh.h"
+
+
+static long long now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+static void sleep_until(long long deadline)
+{
+    struct timespec ts;
+
+    ts.tv_sec = deadline / 1000000000;
+    ts.tv_nsec = deadline % 1000000000;
+    // Returns the error rather than setting errno, EINTR just waits again
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+
+/**
+ * Moves past so many slots, counting them as missed, keeping the schedule
+ * in phase.
+ */
+static void skip(struct refresh * refresh, long long missed)
+{
+    unsigned int i;
+
+    for (i = 0; i < refresh->slots; i++) {
+        refresh->stats[(refresh->slot + i) % refresh->slots].missed +=
+                missed / refresh->slots + (i < missed % refresh->slots);
+    }
+    refresh->slot = (refresh->slot + missed) % refresh->slots;
+    refresh->ticks += missed;
+    refresh->deadline += missed * refresh->period;
+}
+
+
+/**
+ * Skips the slots whose deadline passed by a slot or more.
+ */
+static void skip_missed(struct refresh * refresh, long long now)
+{
+    if (now - refresh->deadline >= refresh->period) {
+        skip(refresh, (now - refresh->deadline) / refresh->period);
+    }
+}
+
+
+static long long sleep_wait(struct refresh * refresh)
+{
+    // Whatever the previous sleep took is the new reference
+    refresh->deadline = refresh->woke + refresh->period;
+    if (refresh->ticks > 0) {
+        usleep(refresh->period / 1000);
+    }
+    return now_ns();
+}
+
+static const struct refresh_policy sleep_policy = {
+    "sleep", "relative sleep of a slot, the delays adding up",
+    NULL, sleep_wait,
+};
+
+
+static long long absolute_wait(struct refresh * refresh)
+{
+    long long now = now_ns();
+
+    skip_missed(refresh, now);
+    if (now < refresh->deadline) {
+        sleep_until(refresh->deadline);
+        now = now_ns();
+    }
+    return now;
+}
+
+static const struct refresh_policy absolute = {
+    "absolute", "absolute deadlines, skipping missed slots",
+    NULL, absolute_wait,
+};
+
+
+static long long rebase_wait(struct refresh * refresh)
+{
+    long long now = now_ns();
+
+    if (now - refresh->deadline >= refresh->period) {
+        refresh->stats[refresh->slot].missed++;
+        refresh->deadline = now;
+        return now;
+    }
+    if (now < refresh->deadline) {
+        sleep_until(refresh->deadline);
+        now = now_ns();
+    }
+    return now;
+}
+
+static const struct refresh_policy rebase = {
+    "rebase", "absolute deadlines, restarting from a missed slot",
+    NULL, rebase_wait,
+};
+
+
+static long long spin_wait(struct refresh * refresh)
+{
+    long long now = now_ns();
+
+    skip_missed(refresh, now);
+    if (now < refresh->deadline - REFRESH_SPIN) {
+        sleep_until(refresh->deadline - REFRESH_SPIN);
+    }
+    do {
+        now = now_ns();
+    } while (now < refresh->deadline);
+    return now;
+}
+
+static const struct refresh_policy spin = {
+    "spin", "absolute deadlines, busy-waiting the end of the waits",
+    NULL, spin_wait,
+};
+
+
+/**
+ * A periodic timerfd armed on the first deadline: the kernel keeps the
+ * schedule, and tells how many periods passed since the last read.
+ */
+static int timerfd_setup(struct refresh * refresh)
+{
+    struct itimerspec spec;
+    long long first = refresh->deadline + refresh->period;
+
+    refresh->fd = timerfd_create(CLOCK_MONOTONIC, 0);
+    if (refresh->fd < 0) {
+        return -1;
+    }
+    spec.it_value.tv_sec = first / 1000000000;
+    spec.it_value.tv_nsec = first % 1000000000;
+    spec.it_interval.tv_sec = refresh->period / 1000000000;
+    spec.it_interval.tv_nsec = refresh->period % 1000000000;
+    if (timerfd_settime(refresh->fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+        close(refresh->fd);
+        refresh->fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+
+static long long timerfd_wait(struct refresh * refresh)
+{
+    uint64_t expirations;
+    ssize_t size;
+
+    do {
+        size = read(refresh->fd, &expirations, sizeof(expirations));
+    } while (size < 0 && errno == EINTR);
+
+    if (size != sizeof(expirations)) {
+        // Cannot happen with a valid timerfd, keep the pace anyway
+        sleep_until(refresh->deadline);
+    } else if (expirations > 1) {
+        skip(refresh, expirations - 1);
+    }
+    return now_ns();
+}
+
+static const struct refresh_policy timerfd = {
+    "timerfd", "periodic timerfd, skipping missed slots",
+    timerfd_setup, timerfd_wait,
+};
+
+
+const struct refresh_policy * const refresh_policies[] = {
+    &absolute,
+    &sleep_policy,
+    &rebase,
+    &spin,
+    &timerfd,
+    NULL,
+};
+
+
+const struct refresh_policy * refresh_policy_find(const char * name)
+{
+    int i;
+
+    if (name == NULL || *name == '\0') {
+        return refresh_policies[0];
+    }
+    for (i = 0; refresh_policies[i] != NULL; i++) {
+        if (strcmp(refresh_policies[i]->name, name) == 0) {
+            return refresh_policies[i];
+        }
+    }
+    return NULL;
+}
+
+
+int refresh_init(struct refresh * refresh, const struct refresh_policy * policy,
+        unsigned int slots, long period)
+{
+    memset(refresh, 0, sizeof(*refresh));
+    refresh->policy = policy;
+    refresh->slots = slots < REFRESH_MAX_SLOTS ? slots : REFRESH_MAX_SLOTS;
+    refresh->period = period * 1000LL;
+    refresh->start = now_ns();
+    // The first slot starts right away
+    refresh->deadline = refresh->start - refresh->period;
+    refresh->woke = refresh->deadline;
+    refresh->fd = -1;
+
+    if (policy->setup != NULL) {
+        return policy->setup(refresh);
+    }
+    return 0;
+}
+
+
+void refresh_close(struct refresh * refresh)
+{
+    if (refresh->fd >= 0) {
+        close(refresh->fd);
+        refresh->fd = -1;
+    }
+}
+
+
+unsigned int refresh_wait(struct refresh * refresh)
+{
+    struct refresh_slot * stats;
+    unsigned int slot;
+    long long now, late;
+
+    refresh->deadline += refresh->period;
+    now = refresh->policy->wait(refresh);
+
+    slot = refresh->slot;
+    stats = &refresh->stats[slot];
+    late = now - refresh->deadline;
+    stats->count++;
+    stats->sum += late;
+    stats->squares += (double)late * late;
+    if (late > stats->max) {
+        stats->max = late;
+    }
+    refresh->woke = now;
+    refresh->drift = now - (refresh->start + (long long)refresh->ticks * refresh->period);
+
+    refresh->ticks++;
+    refresh->slot = (slot + 1) % refresh->slots;
+    return slot;
+}
+
+
+void refresh_print(FILE * stream, const struct refresh * refresh)
+{
+    const struct refresh_slot * stats;
+    double mean;
+    unsigned int i;
+
+    fprintf(stream, "Refresh (%s): %llu slots of %.3f ms, drift %.3f ms\n", refresh->policy->name,
+            refresh->ticks, refresh->period / 1e6, refresh->drift / 1e6);
+    for (i = 0; i < refresh->slots; i++) {
+        stats = &refresh->stats[i];
+        if (stats->count == 0) {
+            fprintf(stream, "  slot %u: never started\n", i);
+            continue;
+        }
+        mean = stats->sum / stats->count;
+        fprintf(stream, "  slot %u: %lu starts, late by %.1f us on average (stddev %.1f, max %.1f), %lu missed\n",
+                i, stats->count, mean / 1e3, sqrt(stats->squares / stats->count - mean * mean) / 1e3,
+                stats->max / 1e3, stats->missed);
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef REFRESH_H
+#define REFRESH_H
+
+#include <stdio.h>
+
+
+/**
+ * Multiplexing scheduler: the digits of the display take turns, each one
+ * lit for a slot, and refresh_wait() returns when the next slot starts.
+ * How it waits is up to a policy:
+ *
+ *   sleep      a relative sleep of one slot after the other, as the
+ *              variants used to: every scheduling delay adds up and the
+ *              refresh rate drifts
+ *   absolute   clock_nanosleep() up to absolute CLOCK_MONOTONIC deadlines
+ *              one slot apart: delays do not add up, and slots missed
+ *              altogether are skipped, keeping the digits in phase
+ *   rebase     likewise, but the schedule restarts from the time of a
+ *              miss instead of skipping
+ *   spin       absolute, the last REFRESH_SPIN being busy-waited: less
+ *              jitter, for a little CPU
+ *   timerfd    a periodic timerfd on the same deadlines, which counts the
+ *              slots missed by itself
+ *
+ * Whatever the policy, the lateness of every slot (the time it started
+ * past its deadline) is accounted for, per slot, along with the drift of
+ * the schedule from the ideal one.
+ */
+
+#define REFRESH_ENV "SEG7_REFRESH"
+
+#define REFRESH_MAX_SLOTS 8
+
+// Default duration of a slot (us)
+#define REFRESH_SLOT 8500
+
+// Busy-waited end of a wait of the spin policy (ns)
+#define REFRESH_SPIN 50000
+
+
+struct refresh;
+
+/**
+ * A policy. setup() is optional and returns -1 with errno set on failure,
+ * wait() sleeps until the next slot and returns the time it woke up (ns),
+ * moving refresh->deadline along as it sees fit.
+ */
+struct refresh_policy {
+    const char * name;
+    const char * description;
+    int (*setup)(struct refresh * refresh);
+    long long (*wait)(struct refresh * refresh);
+};
+
+/**
+ * Lateness of the starts of a slot (ns).
+ */
+struct refresh_slot {
+    unsigned long count;
+    unsigned long missed;       // Skipped, the deadline being past by a slot or more
+    long long max;
+    double sum;
+    double squares;
+};
+
+struct refresh {
+    const struct refresh_policy * policy;
+    unsigned int slots;
+    unsigned int slot;          // The next one
+    long long period;           // Of a slot (ns)
+    long long start;            // Of the schedule (ns)
+    long long deadline;         // Of the next slot (ns)
+    long long woke;             // When the last slot started (ns)
+    unsigned long long ticks;   // Slots elapsed, missed ones included
+    long long drift;            // Last start past the ideal schedule (ns)
+    int fd;                     // Policy owned, e.g. a timerfd
+    struct refresh_slot stats[REFRESH_MAX_SLOTS];
+};
+
+
+/**
+ * Every available policy, NULL terminated, the default first.
+ */
+extern const struct refresh_policy * const refresh_policies[];
+
+/**
+ * Returns the policy with the given name, the default one if name is NULL
+ * or empty, or NULL if there is none.
+ */
+const struct refresh_policy * refresh_policy_find(const char * name);
+
+/**
+ * Starts a schedule of slots turns of period us, the first one now.
+ * Returns -1 with errno set if the policy could not be set up.
+ */
+int refresh_init(struct refresh * refresh, const struct refresh_policy * policy,
+        unsigned int slots, long period);
+
+/**
+ * Releases what the policy holds.
+ */
+void refresh_close(struct refresh * refresh);
+
+/**
+ * Waits for the next slot and returns its index.
+ */
+unsigned int refresh_wait(struct refresh * refresh);
+
+/**
+ * Prints the lateness of every slot, the slots missed and the drift.
+ */
+void refresh_print(FILE * stream, const struct refresh * refresh);
+
+#endif
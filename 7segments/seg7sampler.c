@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+
+#include "display.h"
+
+
+/**
+ * Companion of the simulated display: busy-polls the seg7_rw register of
+ * the shared file and timestamps every change, then reports for every
+ * digit how often it was refreshed, how steadily, how long it was lit
+ * (its duty cycle, i.e. its brightness) and how often it stayed dark long
+ * enough to flicker. A trace of the changes can be saved as CSV.
+ *
+ * Start it, then any variant with SEG7_DISPLAY=sim[:PATH], on a box with
+ * a core to spare: the resolution is that of the polling loop, well
+ * below 1 us.
+ *
+ * Usage: seg7sampler [-f PATH] [-t SECONDS] [-g GAP] [-o TRACE]
+ */
+
+#define CHECKERR(val, fmt, ...) {               \
+    if ((val) < 0) {                            \
+        fprintf(stderr, fmt": ", __VA_ARGS__);  \
+        perror(NULL);                           \
+        exit(EXIT_FAILURE);                     \
+    }                                           \
+}
+
+// A digit dark for longer flickers, 50 Hz being about what the eye tolerates (ms)
+#define FLICKER_GAP 20
+
+// Changes kept for the trace
+#define TRACE_SIZE (1 << 20)
+
+// Polls between two clock readings when nothing changes
+#define CLOCK_POLLS 256
+
+
+struct digit {
+    unsigned long refreshes;    // Times it was lit
+    long long lit_since;        // -1 while dark
+    long long dark_since;       // -1 before it was first lit
+    long long lit;              // Total time lit (ns)
+    long long last_refresh;
+    double period_sum;          // Between successive refreshes (ns)
+    double period_squares;
+    long long period_min;
+    long long period_max;
+    long long longest_dark;
+    unsigned long flickers;     // Dark gaps longer than the threshold
+};
+
+struct change {
+    long long time;
+    uint16_t word;
+};
+
+
+static volatile int stop = 0;
+
+static struct digit digits[DISPLAY_DIGITS];
+static struct change * trace;
+static size_t traced;
+static unsigned long changes;
+
+
+void cleanup()
+{
+    stop = 1;
+}
+
+
+static long long now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+void usage(const char * name)
+{
+    printf("Usage: %s [-f PATH] [-t SECONDS] [-g GAP] [-o TRACE]\n", name);
+    printf("  -f  Shared file of the simulated display (default %s)\n", DISPLAY_SIM_PATH);
+    printf("  -t  Sample for SECONDS, until interrupted if 0 (default)\n");
+    printf("  -g  Dark gap counted as flicker, in ms (default %d)\n", FLICKER_GAP);
+    printf("  -o  Save every change to TRACE as time_ns,word lines\n");
+    exit(EXIT_FAILURE);
+}
+
+
+static int lit(uint16_t word, int digit)
+{
+    return (word & DISPLAY_SELECT_DIGIT(digit)) && (word & DISPLAY_SEGMENTS);
+}
+
+
+/**
+ * Accounts for the register changing from previous to word at time.
+ */
+static void record(uint16_t previous, uint16_t word, long long time, long long gap)
+{
+    struct digit * d;
+    long long period;
+    int i;
+
+    changes++;
+    if (traced < TRACE_SIZE) {
+        trace[traced].time = time;
+        trace[traced++].word = word;
+    }
+
+    for (i = 0; i < DISPLAY_DIGITS; i++) {
+        d = &digits[i];
+        if (lit(previous, i) && !lit(word, i)) {
+            d->lit += time - d->lit_since;
+            d->lit_since = -1;
+            d->dark_since = time;
+        } else if (!lit(previous, i) && lit(word, i)) {
+            if (d->dark_since >= 0) {
+                if (time - d->dark_since > d->longest_dark) {
+                    d->longest_dark = time - d->dark_since;
+                }
+                if (time - d->dark_since > gap) {
+                    d->flickers++;
+                }
+            }
+            if (d->refreshes > 0) {
+                period = time - d->last_refresh;
+                d->period_sum += period;
+                d->period_squares += (double)period * period;
+                if (d->refreshes == 1 || period < d->period_min) {
+                    d->period_min = period;
+                }
+                if (period > d->period_max) {
+                    d->period_max = period;
+                }
+            }
+            d->refreshes++;
+            d->last_refresh = time;
+            d->lit_since = time;
+        }
+    }
+}
+
+
+static void report(long long start, long long end)
+{
+    double duration = (end - start) / 1e9;
+    double mean, deviation;
+    struct digit * d;
+    int i;
+
+    printf("%lu changes in %.3f s\n", changes, duration);
+    for (i = 0; i < DISPLAY_DIGITS; i++) {
+        d = &digits[i];
+        if (d->lit_since >= 0) {
+            d->lit += end - d->lit_since;
+        }
+        if (d->refreshes < 2) {
+            printf("  digit %d: %lu refreshes\n", i + 1, d->refreshes);
+            continue;
+        }
+        mean = d->period_sum / (d->refreshes - 1);
+        deviation = sqrt(d->period_squares / (d->refreshes - 1) - mean * mean);
+        printf("  digit %d: %.1f Hz, period %.3f ms (min %.3f max %.3f, stddev %.3f), duty %.1f%%, "
+                "longest dark %.3f ms, %lu flickers\n", i + 1, 1e9 / mean, mean / 1e6,
+                d->period_min / 1e6, d->period_max / 1e6, deviation / 1e6,
+                d->lit * 100.0 / (end - start), d->longest_dark / 1e6, d->flickers);
+    }
+}
+
+
+static void save(const char * path)
+{
+    FILE * file = fopen(path, "w");
+    size_t i;
+
+    if (file == NULL) {
+        CHECKERR(-1, "Failed to open %s", path);
+    }
+    fprintf(file, "time_ns,word\n");
+    for (i = 0; i < traced; i++) {
+        fprintf(file, "%lld,0x%03x\n", trace[i].time, trace[i].word);
+    }
+    CHECKERR(fclose(file), "Failed to write %s", path);
+    if (traced < changes) {
+        printf("Trace truncated to the first %zu changes\n", traced);
+    }
+}
+
+
+int main(int argc, char ** argv)
+{
+    const char * path = DISPLAY_SIM_PATH;
+    const char * output = NULL;
+    struct display display;
+    struct sigaction sa;
+    long long start, end, time, gap = FLICKER_GAP * 1000000LL;
+    uint16_t previous, word;
+    int seconds = 0;
+    int polls = 0;
+    int opt;
+    int i;
+
+    while ((opt = getopt(argc, argv, "f:t:g:o:")) != -1) {
+        switch (opt) {
+            case 'f': path = optarg; break;
+            case 't': seconds = atoi(optarg); break;
+            case 'g': gap = atol(optarg) * 1000000LL; break;
+            case 'o': output = optarg; break;
+            default: usage(argv[0]);
+        }
+    }
+
+    trace = malloc(TRACE_SIZE * sizeof(*trace));
+    if (trace == NULL) {
+        CHECKERR(-1, "Failed to allocate %d changes", TRACE_SIZE);
+    }
+    for (i = 0; i < DISPLAY_DIGITS; i++) {
+        digits[i].lit_since = -1;
+        digits[i].dark_since = -1;
+    }
+
+    CHECKERR(display_map_shared(&display, path), "Failed to map %s", path);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = cleanup;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    start = now_ns();
+    end = seconds > 0 ? start + seconds * 1000000000LL : -1;
+    previous = 0;
+    time = start;
+    printf("Sampling %s...\n", path);
+
+    while (!stop) {
+        word = display.gpio->seg7_rw;
+        if (word != previous) {
+            time = now_ns();
+            record(previous, word, time, gap);
+            previous = word;
+            polls = 0;
+        } else if (++polls == CLOCK_POLLS) {
+            time = now_ns();
+            polls = 0;
+        }
+        if (end >= 0 && time >= end) {
+            break;
+        }
+    }
+
+    report(start, now_ns());
+    if (output != NULL) {
+        save(output);
+    }
+    display_close(&display);
+    return EXIT_SUCCESS;
+}
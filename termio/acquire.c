@@ -0,0 +1,574 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
+
+#include "acquire.h"
+#include "parser.h"
+
+
+static long long now_us()
+{
+    struct timespec ts;
+
+    CHECKERR(clock_gettime(CLOCK_MONOTONIC, &ts), "Couldn't read clock (%d)", CLOCK_MONOTONIC);
+
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+const struct strategy * strategy_find(const char * name)
+{
+    int i;
+
+    for (i = 0; strategies[i] != NULL; i++) {
+        if (strcmp(strategies[i]->name, name) == 0) {
+            return strategies[i];
+        }
+    }
+    return NULL;
+}
+
+
+static void configure(struct line * line)
+{
+    struct profile * profile = &line->profile;
+    struct termios conf;
+    speed_t speed;
+    int vmin = profile->vmin > 0 ? profile->vmin : line->frame;
+    int fd = line->fd;
+
+    printf("Configuring through termios (%s, %s, %ld bauds)...\n", line->strategy->name,
+            profile->name, profile->baud);
+
+    // Zero out the struct
+    memset(&conf, 0, sizeof(conf));
+
+    // Configure flags
+    conf.c_iflag = IGNCR;
+    conf.c_oflag = 0;
+    conf.c_cflag = CS8 | CREAD;
+
+    if (profile->canonical) {
+        conf.c_lflag = ICANON;
+    } else {
+        // Wake up once per frame rather than once per burst of bytes
+        conf.c_lflag = 0;
+        conf.c_cc[VMIN] = vmin < 1 ? 1 : vmin > 255 ? 255 : vmin;
+        conf.c_cc[VTIME] = profile->vtime;
+    }
+
+    // The strategy has the last word, it may rely on a mode of its own
+    if (line->strategy->configure != NULL) {
+        line->strategy->configure(line, &conf);
+    }
+
+    // Set speed
+    if (baud_to_speed(profile->baud, &speed) < 0) {
+        fprintf(stderr, "Unsupported speed %ld for %s\n", profile->baud, line->path);
+        exit(EXIT_FAILURE);
+    }
+    CHECKERR(cfsetispeed(&conf, speed), "Couldn't set in speed (fd=%d)", fd);
+    CHECKERR(cfsetospeed(&conf, speed), "Couldn't set out speed (fd=%d)", fd);
+
+    // Save previous termios config and apply the new one
+    CHECKERR(tcgetattr(fd, &line->saved_conf), "Couldn't save termios (fd=%d)", fd);
+    line->conf_was_saved = 1;
+    CHECKERR(tcsetattr(fd, TCSAFLUSH, &conf), "Couldn't set termios (fd=%d)", fd);
+}
+
+
+/**
+ * Stores the outcome of a frame received at time (us), when journaling.
+ */
+static void record(struct line * line, long long time, enum journal_status status, const struct sample * sample)
+{
+    struct journal_record record;
+
+    if (!line->journaling) {
+        return;
+    }
+    memset(&record, 0, sizeof(record));
+    record.time = time;
+    record.status = status;
+    if (sample != NULL) {
+        record.sensor = sample->sensor;
+        record.measure = sample->measure;
+        record.value = sample->value.mantissa;
+        record.scale = sample->value.scale;
+    }
+    CHECKERR(journal_append(&line->journal, &record), "Failed to write journal of %s", line->path);
+}
+
+
+static void save_stats(struct line * line)
+{
+    CHECKERR(stats_save(line->sensors, line->snapshot), "Failed to save statistics to %s", line->snapshot);
+}
+
+
+static void process(struct line * line, char * frame, size_t len, long long time)
+{
+    struct sample sample;
+    enum parse_status status;
+
+    status = parse_frame(frame, len, &sample);
+    if (status != PARSE_OK) {
+        line->stats.malformed++;
+        record(line, time, JOURNAL_MALFORMED, NULL);
+        if (line->quiet) {
+            return;
+        }
+        CHECKERR(sink_rejected(&line->sink, parse_strerror(status), frame, len),
+                "Failed to write output of %s", line->path);
+    } else {
+        line->stats.samples++;
+        record(line, time, JOURNAL_SAMPLE, &sample);
+        if (line->storing) {
+            // Rejections are counted by the store, they do not stop the line
+            store_append(&line->store, time, &sample);
+        }
+        if (line->snapshot != NULL) {
+            // Likewise
+            stats_add(line->sensors, &sample);
+            if (time - line->saved >= STATS_PERIOD) {
+                save_stats(line);
+                line->saved = time;
+            }
+        }
+        if (line->quiet) {
+            return;
+        }
+        CHECKERR(sink_sample(&line->sink, &sample), "Failed to write output of %s", line->path);
+    }
+}
+
+
+static void handle_frame(struct line * line, char * frame, size_t len, int too_long, long long time)
+{
+    char text[80];
+
+    if (too_long) {
+        line->stats.too_long++;
+        record(line, time, JOURNAL_TOO_LONG, NULL);
+        if (!line->quiet) {
+            snprintf(text, sizeof(text), " - Received data is too long (%zu), skipping it...\n", len);
+            line_note(line, text);
+        }
+        return;
+    }
+    // We found a line feed (CRs are ignored by termios)
+    process(line, frame, len, time);
+}
+
+
+/**
+ * Drains the ring until the line is closed, sleeping on the eventfd
+ * whenever it is empty.
+ */
+static void * worker(void * arg)
+{
+    struct line * line = arg;
+    struct ring_slot * slot;
+    struct pollfd pfd;
+    uint64_t value;
+    int ret;
+
+    pfd.fd = line->wake_fd;
+    pfd.events = POLLIN;
+
+    while (1) {
+        slot = spsc_peek(&line->ring);
+        if (slot != NULL) {
+            handle_frame(line, slot->frame, slot->len, slot->too_long, slot->time);
+            spsc_release(&line->ring);
+            continue;
+        }
+        if (line->done) {
+            break;
+        }
+        CHECKERR(sink_tick(&line->sink), "Failed to write output of %s", line->path);
+
+        // Tell the reader we are going to sleep, then check again: either
+        // we see what it published meanwhile, or it sees the flag. Pending
+        // output cuts the sleep short.
+        line->waiting = 1;
+        __sync_synchronize();
+        if (spsc_peek(&line->ring) == NULL && !line->done) {
+            ret = poll(&pfd, 1, sink_due(&line->sink));
+            if (ret > 0) {
+                ret = read(line->wake_fd, &value, sizeof(value));
+            }
+            if (ret < 0 && errno != EINTR) {
+                perror("Worker failed to wait for frames");
+                break;
+            }
+        }
+        line->waiting = 0;
+    }
+
+    CHECKERR(sink_flush(&line->sink), "Failed to write output of %s", line->path);
+    return NULL;
+}
+
+
+static void wake_worker(struct line * line)
+{
+    uint64_t value = 1;
+
+    __sync_synchronize();
+    if (line->waiting || line->done) {
+        CHECKERR(write(line->wake_fd, &value, sizeof(value)), "Couldn't wake worker of %s", line->path);
+    }
+}
+
+
+static void start_worker(struct line * line, unsigned int size)
+{
+    sigset_t all, saved;
+    int ret;
+
+    CHECKERR(spsc_init(&line->ring, size, sizeof(struct ring_slot)), "Failed to allocate %u slots", size);
+    line->wake_fd = eventfd(0, 0);
+    CHECKERR(line->wake_fd, "Failed to create eventfd for %s", line->path);
+    line->ring_size = size;
+
+    // Signals (SIGINT, SIGALRM...) are for the reader, which they interrupt
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+    ret = pthread_create(&line->worker, NULL, worker, line);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+    if (ret != 0) {
+        errno = ret;
+        CHECKERR(-1, "Failed to start worker for %s", line->path);
+    }
+}
+
+
+static void stop_worker(struct line * line)
+{
+    line->done = 1;
+    wake_worker(line);
+    pthread_join(line->worker, NULL);
+    close(line->wake_fd);
+    spsc_destroy(&line->ring);
+}
+
+
+/**
+ * Moves every complete frame to the ring without looking into it. Frames
+ * which do not fit are dropped and counted, the line is never held up by
+ * the worker.
+ */
+static int hand_over(struct line * line, long long now)
+{
+    struct ring_slot scratch;
+    struct ring_slot * slot;
+    enum frame_status status;
+    unsigned int occupancy;
+    size_t len;
+    int count = 0;
+
+    while (1) {
+        slot = spsc_claim(&line->ring);
+        status = framer_next(&line->framer, slot != NULL ? slot->frame : scratch.frame, BUFSIZE, &len);
+        if (status == FRAME_NONE) {
+            break;
+        }
+        count++;
+        if (slot == NULL) {
+            line->stats.dropped++;
+            continue;
+        }
+
+        slot->len = len;
+        slot->too_long = (status == FRAME_TOO_LONG);
+        slot->time = now;
+        spsc_publish(&line->ring);
+
+        occupancy = spsc_count(&line->ring);
+        if (occupancy > line->stats.high_water) {
+            line->stats.high_water = occupancy;
+        }
+    }
+
+    if (count > 0) {
+        wake_worker(line);
+    }
+    return count;
+}
+
+
+void line_open(struct line * line, const char * path, const struct line_config * config)
+{
+    const struct strategy * strategy = config->strategy;
+
+    memset(line, 0, sizeof(*line));
+    line->path = path;
+    line->strategy = strategy;
+    line->profile = config->profile;
+    line->frame = config->frame;
+    line->timeout = config->timeout;
+    line->quiet = config->quiet;
+    line->deadline = -1;
+    line->private_fd = -1;
+    framer_init(&line->framer, BUFSIZE - 1);
+    histogram_init(&line->stats.latency);
+    sink_init(&line->sink, config->output, config->format, config->flush_size, config->flush_delay);
+
+    if (config->store > 0) {
+        store_init(&line->store, config->store);
+        line->storing = 1;
+    }
+    if (config->stats != NULL) {
+        // Over 400 KB, kept off the stack and only when asked for
+        line->sensors = malloc(sizeof(*line->sensors));
+        CHECKERR(line->sensors == NULL ? -1 : 0, "Failed to allocate statistics for %s", path);
+        stats_init(line->sensors);
+        line->snapshot = config->stats;
+        line->saved = now_us();
+    }
+    if (config->journal != NULL) {
+        CHECKERR(journal_open(&line->journal, config->journal, config->journal_size, JOURNAL_SYNC),
+                "Failed to open journal %s", config->journal);
+        line->journaling = 1;
+    }
+
+    printf("Opening device at '%s'...\n", path);
+    line->fd = open(path, O_RDWR | strategy->flags);
+    CHECKERR(line->fd, "Failed to open device %s", path);
+
+    configure(line);
+
+    if (strategy->setup != NULL) {
+        strategy->setup(line);
+    }
+
+    if (config->ring > 0) {
+        start_worker(line, config->ring);
+    }
+}
+
+
+void line_close(struct line * line)
+{
+    if (line->ring_size > 0) {
+        stop_worker(line);
+    } else {
+        CHECKERR(sink_flush(&line->sink), "Failed to write output of %s", line->path);
+    }
+    if (line->snapshot != NULL) {
+        save_stats(line);
+    }
+    if (line->storing) {
+        store_destroy(&line->store);
+    }
+    if (line->journaling) {
+        CHECKERR(journal_close(&line->journal), "Failed to close journal %s", line->journal.path);
+    }
+    if (line->strategy->teardown != NULL) {
+        line->strategy->teardown(line);
+    }
+    if (line->conf_was_saved) {
+        CHECKERR(tcsetattr(line->fd, TCSAFLUSH, &line->saved_conf), "Couldn't reset termios for fd=%d", line->fd);
+    }
+    close(line->fd);
+}
+
+
+ssize_t line_request(struct line * line)
+{
+    ssize_t size = write(line->fd, "get", 3);
+
+    if (size >= 0) {
+        line->sent = now_us();
+        line->deadline = line->timeout > 0 ? line->sent + line->timeout * 1000LL : -1;
+    }
+    return size;
+}
+
+
+enum read_status line_read(struct line * line)
+{
+    enum read_status status = line->strategy->read(line);
+
+    if (status == READ_TIMEOUT && line->sent != 0) {
+        line->stats.timeouts++;
+        line->sent = 0;
+    }
+    return status;
+}
+
+
+ssize_t line_readv(struct line * line)
+{
+    struct iovec iov[2];
+    ssize_t size;
+    int count;
+
+    count = framer_iov(&line->framer, iov);
+    size = readv(line->fd, iov, count);
+    if (size > 0) {
+        framer_commit(&line->framer, size);
+        line->stats.reads++;
+        line->stats.bytes += size;
+    }
+    return size;
+}
+
+
+int line_remaining(struct line * line)
+{
+    long long left;
+
+    if (line->deadline < 0) {
+        return -1;
+    }
+    left = line->deadline - now_us();
+    return left > 0 ? (int)((left + 999) / 1000) : 0;
+}
+
+
+void line_tick(struct line * line)
+{
+    // The worker thread, if any, flushes by itself
+    if (line->ring_size == 0) {
+        CHECKERR(sink_tick(&line->sink), "Failed to write output of %s", line->path);
+    }
+}
+
+
+enum read_status line_idle(struct line * line, int timed)
+{
+    struct pollfd pfd;
+    int due, remaining, ret;
+
+    if (line->ring_size > 0) {
+        return READ_OK;
+    }
+    pfd.fd = line->fd;
+    pfd.events = POLLIN;
+
+    while ((due = sink_due(&line->sink)) >= 0) {
+        remaining = timed ? line_remaining(line) : -1;
+        if (remaining == 0) {
+            return READ_TIMEOUT;
+        }
+        ret = poll(&pfd, 1, remaining >= 0 && remaining < due ? remaining : due);
+        if (ret < 0 && errno == EINTR) {
+            return READ_INTERRUPTED;
+        }
+        CHECKERR(ret, "Failed to wait for data (fd=%d)", line->fd);
+        if (ret > 0) {
+            return READ_OK;
+        }
+        line_tick(line);
+    }
+    return READ_OK;
+}
+
+
+int line_process(struct line * line)
+{
+    char frame[BUFSIZE];
+    size_t len;
+    enum frame_status status;
+    long long now = 0;
+    int count = 0;
+
+    // A single clock reading dates every frame of the read
+    if (line->journaling || line->storing || line->snapshot != NULL || line->sent != 0) {
+        now = now_us();
+    }
+
+    if (line->ring_size > 0) {
+        count = hand_over(line, now);
+    } else {
+        while ((status = framer_next(&line->framer, frame, sizeof(frame), &len)) != FRAME_NONE) {
+            count++;
+            handle_frame(line, frame, len, status == FRAME_TOO_LONG, now);
+        }
+        line_tick(line);
+    }
+    line->stats.frames += count;
+
+    if (count > 0 && line->sent != 0) {
+        histogram_record(&line->stats.latency, now - line->sent);
+        line->sent = 0;
+    }
+
+    return count;
+}
+
+
+void line_note(struct line * line, const char * text)
+{
+    // The other formats are for programs, which get nothing but samples
+    if (line->sink.format != SINK_HUMAN) {
+        fputs(text, stdout);
+        return;
+    }
+    CHECKERR(sink_text(&line->sink, text), "Failed to write output of %s", line->path);
+    // Notes come on timeouts too, when no frame will flush them
+    CHECKERR(sink_tick(&line->sink), "Failed to write output of %s", line->path);
+}
+
+
+void line_print_stats(struct line * line)
+{
+    struct line_stats * stats = &line->stats;
+
+    printf("[%s] %lu samples, %lu timeouts, %lu too long, %lu malformed, %lu waits (%s)\n",
+            line->path, stats->samples, stats->timeouts, stats->too_long, stats->malformed,
+            stats->waits, line->strategy->name);
+    histogram_print(stdout, &stats->latency, "  latency (ms)", 1000.0);
+    printf("  output: %lu records, %llu bytes in %lu writes (%s)\n", line->sink.records,
+            line->sink.bytes, line->sink.flushes, sink_format_name(line->sink.format));
+    if (line->storing) {
+        printf("  store: %llu samples, %llu evicted, %lu rejected\n", line->store.appended,
+                line->store.evicted, line->store.rejected);
+    }
+    if (line->snapshot != NULL) {
+        printf("  stats: %llu samples, %lu rejected, saved to %s\n", line->sensors->added,
+                line->sensors->rejected, line->snapshot);
+        stats_print(stdout, line->sensors, "    sensor");
+    }
+    if (line->journaling) {
+        printf("  journal: %llu records, %lu recovered, %lu syncs, up to %s.%06u\n", line->journal.appended,
+                line->journal.recovered, line->journal.syncs, line->journal.path, line->journal.segment);
+    }
+    if (line->ring_size > 0) {
+        printf("  ring: %u slots, high water %u, %lu frames dropped\n",
+                line->ring_size, stats->high_water, stats->dropped);
+    }
+}
+
+
+void line_print_io(struct line * line)
+{
+    struct line_stats * stats = &line->stats;
+    unsigned long frames = stats->frames;
+
+    if (frames == 0 || stats->reads == 0) {
+        printf("[%s] No frame received\n", line->path);
+        return;
+    }
+    printf("[%s] %lu frames, %.2f reads per frame, %.1f bytes per wakeup, %.2f sleeps per frame",
+            line->path, frames, (double)stats->reads / frames, (double)stats->bytes / stats->reads,
+            (double)stats->waits / frames);
+    if (line->ring_size > 0) {
+        printf(", ring %u/%u (high water %u), %lu dropped", spsc_count(&line->ring),
+                line->ring_size, stats->high_water, stats->dropped);
+    }
+    printf("\n");
+}
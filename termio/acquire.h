@@ -0,0 +1,269 @@
+#ifndef ACQUIRE_H
+#define ACQUIRE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "framer.h"
+#include "histogram.h"
+#include "journal.h"
+#include "sink.h"
+#include "spsc.h"
+#include "stats.h"
+#include "store.h"
+
+
+/**
+ * Single-line acquisition engine: opens and configures a serial line,
+ * sends "get" requests and splits the answers into frames which are
+ * parsed and accounted for. How the line is read, and how a response
+ * timeout is implemented, is left to a pluggable I/O strategy.
+ */
+
+#define CHECKERR(val, fmt, ...) {               \
+    if ((val) < 0) {                            \
+        fprintf(stderr, fmt": ", __VA_ARGS__);  \
+        perror(NULL);                           \
+        exit(EXIT_FAILURE);                     \
+    }                                           \
+}
+
+#define BUFSIZE 51
+
+// Default response timeout (ms)
+#define TIMEOUT 620
+
+// Default length of the shortest expected frame, "StringFromSensor1_1_0.000\n"
+#define FRAME_LENGTH 26
+
+
+struct line;
+
+/**
+ * Outcome of a strategy read. Errors other than interruptions are fatal
+ * and handled by the strategy itself.
+ */
+enum read_status {
+    READ_OK,                    // Some bytes were added to the framer
+    READ_TIMEOUT,               // The deadline of the request passed
+    READ_INTERRUPTED,           // A signal interrupted the wait
+};
+
+/**
+ * An I/O strategy. configure() adjusts the termios settings the line is
+ * about to get, setup() and teardown() are optional, read() waits for and
+ * reads data into the framer of the line, honouring line->deadline.
+ */
+struct strategy {
+    const char * name;
+    const char * description;
+    int flags;                  // Extra open() flags
+    void (*configure)(struct line * line, struct termios * conf);
+    void (*setup)(struct line * line);
+    enum read_status (*read)(struct line * line);
+    void (*teardown)(struct line * line);
+};
+
+/**
+ * Line settings. In canonical mode the terminal driver splits the lines
+ * and every read returns one. In raw mode the framer does it in user
+ * space and a blocking read returns once vmin bytes arrived, or vtime
+ * tenths of a second after the last byte: a vmin sized to the frame costs
+ * one wakeup per frame instead of one per burst of bytes. poll() only
+ * waits for vmin bytes when vtime is 0.
+ */
+struct profile {
+    const char * name;
+    const char * description;
+    long baud;
+    int canonical;
+    int vmin;                   // 0 to size it to the expected frame
+    int vtime;
+};
+
+struct line_config {
+    const struct strategy * strategy;
+    struct profile profile;     // A copy, for the options to override
+    int frame;                  // Shortest expected frame (bytes)
+    int timeout;                // Response timeout (ms), 0 for none
+    int quiet;                  // Count the samples without printing them
+    unsigned int ring;          // Slots handed over to a worker thread, 0 for none
+    enum sink_format format;    // How the samples are written
+    int output;                 // Where to, usually STDOUT_FILENO
+    size_t flush_size;          // Output batched up to so many bytes...
+    int flush_delay;            // ...or so many ms
+    const char * journal;       // Binary journal path, NULL for none
+    size_t journal_size;        // Size of its segments
+    size_t store;               // Memory kept for recent samples, 0 for none
+    const char * stats;         // Per-sensor statistics snapshot path, NULL for none
+};
+
+/**
+ * Always-on instrumentation, latencies in us. With a worker thread,
+ * samples, too_long and malformed belong to the worker and must only be
+ * read once it is stopped.
+ */
+struct line_stats {
+    struct histogram latency;   // "get" written to first frame processed
+    unsigned long samples;
+    unsigned long timeouts;
+    unsigned long too_long;
+    unsigned long malformed;
+    unsigned long waits;        // Times the strategy went to sleep
+    unsigned long reads;        // Reads returning data
+    unsigned long bytes;
+    unsigned long frames;       // Split by the framer
+    unsigned long dropped;      // Frames lost to a full ring
+    unsigned int high_water;    // Highest ring occupancy seen
+};
+
+/**
+ * A frame handed over to the worker thread.
+ */
+struct ring_slot {
+    long long time;             // When it was read (us)
+    size_t len;
+    int too_long;
+    char frame[BUFSIZE];
+};
+
+struct line {
+    const char * path;
+    int fd;
+    const struct strategy * strategy;
+    struct profile profile;
+    struct termios saved_conf;
+    int conf_was_saved;
+
+    int frame;                  // Shortest expected frame (bytes)
+    int timeout;                // Response timeout (ms), 0 for none
+    int quiet;
+    long long sent;             // Last "get" written (us), 0 if none pending
+    long long deadline;         // Response deadline (us), -1 for none
+    int private_fd;             // Strategy owned, e.g. a timerfd
+
+    struct framer framer;
+    struct line_stats stats;
+    struct sink sink;           // Owned by the worker thread if any
+    struct journal journal;     // Likewise
+    int journaling;
+    struct store store;         // Likewise
+    int storing;
+    struct stats * sensors;     // Likewise, allocated if kept and left for line_print_stats()
+    const char * snapshot;      // Where they are saved, NULL if they are not kept
+    long long saved;            // Last snapshot (us)
+
+    // Worker thread parsing and printing, when ring is non zero
+    unsigned int ring_size;
+    struct spsc ring;
+    pthread_t worker;
+    int wake_fd;                // eventfd the worker sleeps on
+    volatile int waiting;       // The worker is, or is about to, sleep
+    volatile int done;
+};
+
+
+/**
+ * Every available strategy, NULL terminated.
+ */
+extern const struct strategy * const strategies[];
+
+/**
+ * Returns the strategy with the given name, or NULL.
+ */
+const struct strategy * strategy_find(const char * name);
+
+/**
+ * Every predefined profile, terminated by an entry without name.
+ */
+extern const struct profile profiles[];
+
+/**
+ * Returns the profile with the given name, or NULL.
+ */
+const struct profile * profile_find(const char * name);
+
+/**
+ * Converts a baud rate into a termios speed. Returns -1 if it is not
+ * supported.
+ */
+int baud_to_speed(long baud, speed_t * speed);
+
+/**
+ * Opens and configures the line, and starts its worker thread if asked
+ * to.
+ */
+void line_open(struct line * line, const char * path, const struct line_config * config);
+
+/**
+ * Waits for the worker thread to drain the ring, flushes the output and
+ * the journal, saves the statistics, releases the store, restores the
+ * termios settings of the line and closes it.
+ */
+void line_close(struct line * line);
+
+/**
+ * Writes a "get" and starts its deadline. Returns the write() result.
+ */
+ssize_t line_request(struct line * line);
+
+/**
+ * Reads what is available through the strategy of the line.
+ */
+enum read_status line_read(struct line * line);
+
+/**
+ * readv() into the framer of the line, committing what was read. Meant
+ * for the strategies.
+ */
+ssize_t line_readv(struct line * line);
+
+/**
+ * Milliseconds left before the deadline, 0 if it passed, -1 without one.
+ */
+int line_remaining(struct line * line);
+
+/**
+ * Flushes the output if it is due. Meant for the strategies, between two
+ * attempts at reading.
+ */
+void line_tick(struct line * line);
+
+/**
+ * While output is pending, waits for the line to be readable but no
+ * longer than the output may wait, flushing it when due: a quiet line
+ * never holds it back. Meant for the strategies, before they block.
+ * Returns READ_OK once the line is readable or nothing is pending,
+ * READ_TIMEOUT if timed and the deadline passed meanwhile,
+ * READ_INTERRUPTED if a signal interrupted the wait.
+ */
+enum read_status line_idle(struct line * line, int timed);
+
+/**
+ * Parses and outputs every complete frame buffered, or hands them over to
+ * the worker thread, and returns how many were found. The first one
+ * completes the pending request.
+ */
+int line_process(struct line * line);
+
+/**
+ * Writes a line of text in between the samples, in order with them. Only
+ * for the thread processing the frames.
+ */
+void line_note(struct line * line, const char * text);
+
+/**
+ * Prints the statistics gathered so far.
+ */
+void line_print_stats(struct line * line);
+
+/**
+ * Prints how the profile batches the input: reads per frame, bytes per
+ * read (i.e. per wakeup with data) and strategy sleeps per frame.
+ */
+void line_print_io(struct line * line);
+
+#endif
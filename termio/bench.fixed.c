@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fixed.h"
+#include "parser.h"
+
+
+/**
+ * Microbenchmark of the value pipeline, parsing, aggregation (min, max
+ * and sum) and formatting, in decimal fixed point against the doubles
+ * previously used. Most telling on the APF27, where every double
+ * operation is a soft-float library call.
+ *
+ * Usage: bench.fixed [ITERATIONS]
+ */
+
+#define CORPUS_SIZE 4096
+#define FRAME_SIZE 51
+#define TEXT_SIZE 48
+#define DEFAULT_ITERATIONS 200
+
+
+struct aggregate {
+    double min, max, sum;
+};
+
+struct fixed_aggregate {
+    int64_t min, max, sum;
+};
+
+static char frames[CORPUS_SIZE][FRAME_SIZE];
+static size_t lengths[CORPUS_SIZE];
+static struct sample samples[CORPUS_SIZE];
+static double values[CORPUS_SIZE];
+static char texts[CORPUS_SIZE][TEXT_SIZE];
+
+static volatile double double_sink;
+static volatile int64_t fixed_sink;
+
+
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+void build_corpus()
+{
+    int i;
+
+    srand(42);
+
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        snprintf(frames[i], FRAME_SIZE, "StringFromSensor%d_%d_%.3f\n",
+                rand() % 64, i, (rand() % 2000000 - 1000000) / 1000.0);
+        lengths[i] = strlen(frames[i]);
+        parse_frame(frames[i], lengths[i], &samples[i]);
+        values[i] = fixed_to_double(samples[i].value);
+    }
+}
+
+
+void parse_double()
+{
+    struct sample sample;
+    int i;
+
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        parse_frame(frames[i], lengths[i], &sample);
+        values[i] = fixed_to_double(sample.value);
+    }
+}
+
+
+void parse_fixed()
+{
+    int i;
+
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        parse_frame(frames[i], lengths[i], &samples[i]);
+    }
+}
+
+
+struct aggregate aggregate_double()
+{
+    struct aggregate result = { values[0], values[0], 0 };
+    int i;
+
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        if (values[i] < result.min) {
+            result.min = values[i];
+        }
+        if (values[i] > result.max) {
+            result.max = values[i];
+        }
+        result.sum += values[i];
+    }
+    return result;
+}
+
+
+/**
+ * Every sample of the corpus has the same scale, as those of a sensor do.
+ */
+struct fixed_aggregate aggregate_fixed()
+{
+    struct fixed_aggregate result = { samples[0].value.mantissa, samples[0].value.mantissa, 0 };
+    int64_t mantissa;
+    int i;
+
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        mantissa = samples[i].value.mantissa;
+        if (mantissa < result.min) {
+            result.min = mantissa;
+        }
+        if (mantissa > result.max) {
+            result.max = mantissa;
+        }
+        result.sum += mantissa;
+    }
+    return result;
+}
+
+
+void format_double()
+{
+    int i;
+
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        snprintf(texts[i], TEXT_SIZE, "%08.3f", values[i]);
+    }
+}
+
+
+void format_fixed_all()
+{
+    int i;
+
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        *format_fixed(texts[i], samples[i].value, 3, 8) = '\0';
+    }
+}
+
+
+void run_aggregate_double()
+{
+    double_sink = aggregate_double().sum;
+}
+
+
+void run_aggregate_fixed()
+{
+    fixed_sink = aggregate_fixed().sum;
+}
+
+
+double bench(void (*run)(), int iterations)
+{
+    double start;
+    int i;
+
+    start = now();
+    for (i = 0; i < iterations; i++) {
+        run();
+    }
+    return (now() - start) * 1e9 / ((double)iterations * CORPUS_SIZE);
+}
+
+
+/**
+ * Both paths have to agree on the aggregates and, byte for byte, on the
+ * formatted values.
+ */
+int check()
+{
+    char expected[TEXT_SIZE];
+    struct aggregate reference = aggregate_double();
+    struct fixed_aggregate result = aggregate_fixed();
+    int errors = 0;
+    int i;
+
+    if (reference.min * 1000 != result.min || reference.max * 1000 != result.max
+            || (int64_t)(reference.sum * 1000 + (reference.sum < 0 ? -0.5 : 0.5)) != result.sum) {
+        printf("Aggregates differ: %f %f %f\n", reference.min, reference.max, reference.sum);
+        errors++;
+    }
+
+    format_fixed_all();
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        snprintf(expected, TEXT_SIZE, "%08.3f", values[i]);
+        if (strcmp(expected, texts[i]) != 0) {
+            printf("Mismatch on sample %d: %s instead of %s\n", i, texts[i], expected);
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+
+int main(int argc, char ** argv)
+{
+    int iterations = DEFAULT_ITERATIONS;
+
+    if (argc > 2) {
+        printf("Usage: %s [ITERATIONS]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (argc == 2) {
+        iterations = atoi(argv[1]);
+    }
+
+    build_corpus();
+
+    if (check()) {
+        exit(EXIT_FAILURE);
+    }
+
+    printf("%-10s %12s %12s\n", "stage", "double", "fixed");
+    printf("%-10s %9.1f ns %9.1f ns\n", "parse",
+            bench(parse_double, iterations), bench(parse_fixed, iterations));
+    printf("%-10s %9.1f ns %9.1f ns\n", "aggregate",
+            bench(run_aggregate_double, iterations), bench(run_aggregate_fixed, iterations));
+    printf("%-10s %9.1f ns %9.1f ns\n", "format",
+            bench(format_double, iterations), bench(format_fixed_all, iterations));
+
+    return EXIT_SUCCESS;
+}
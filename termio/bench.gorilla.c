@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gorilla.h"
+#include "journal.h"
+#include "parser.h"
+
+
+/**
+ * Compression ratio and throughput of the Gorilla blocks, on a synthetic
+ * stream shaped like the real one: a few sensors polled at 10 Hz with a
+ * few ms of jitter, consecutive measures with the odd lost one, and
+ * slowly drifting values with three decimals. Throughputs are given in
+ * MB/s of journal records (32 bytes per sample).
+ *
+ * Usage: bench.gorilla [SAMPLES]
+ */
+
+#define SENSORS 4
+#define BLOCK_SIZE 4096
+#define PERIOD 100000
+#define JITTER 3000
+#define DEFAULT_SAMPLES 1000000
+
+
+struct series {
+    int64_t * times;
+    struct sample * samples;
+    size_t count;
+};
+
+static struct series series[SENSORS];
+
+// Every block, one after the other, with its size
+static uint8_t * blocks;
+static size_t * block_sizes;
+static size_t block_count;
+static size_t block_bytes;
+
+
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+void * allocate(size_t size)
+{
+    void * memory = malloc(size);
+
+    if (memory == NULL) {
+        perror("Failed to allocate");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+
+void build_series(size_t samples)
+{
+    struct series * s;
+    int64_t mantissa;
+    int64_t time;
+    unsigned int measure;
+    size_t i;
+    int j;
+
+    srand(42);
+
+    for (j = 0; j < SENSORS; j++) {
+        s = &series[j];
+        s->count = samples / SENSORS;
+        s->times = allocate(s->count * sizeof(*s->times));
+        s->samples = allocate(s->count * sizeof(*s->samples));
+
+        time = 1000000LL * j;
+        measure = 1;
+        mantissa = 20000 + rand() % 60000;
+        for (i = 0; i < s->count; i++) {
+            time += PERIOD + rand() % (2 * JITTER + 1) - JITTER;
+            measure += (rand() % 100 == 0) ? 2 : 1;
+            mantissa += rand() % 41 - 20;
+
+            s->times[i] = time;
+            s->samples[i].sensor = j + 1;
+            s->samples[i].measure = measure;
+            s->samples[i].value.mantissa = mantissa;
+            s->samples[i].value.scale = 3;
+        }
+    }
+}
+
+
+void encode()
+{
+    struct gorilla_encoder encoder;
+    struct series * s;
+    uint8_t * block;
+    size_t i;
+    int j;
+
+    block_count = 0;
+    block_bytes = 0;
+
+    for (j = 0; j < SENSORS; j++) {
+        s = &series[j];
+        block = blocks + block_bytes;
+        gorilla_encoder_init(&encoder, block, BLOCK_SIZE);
+        for (i = 0; i < s->count; i++) {
+            if (!gorilla_append(&encoder, s->times[i], &s->samples[i])) {
+                block_sizes[block_count] = gorilla_finish(&encoder);
+                block_bytes += block_sizes[block_count++];
+                block = blocks + block_bytes;
+                gorilla_encoder_init(&encoder, block, BLOCK_SIZE);
+                gorilla_append(&encoder, s->times[i], &s->samples[i]);
+            }
+        }
+        block_sizes[block_count] = gorilla_finish(&encoder);
+        block_bytes += block_sizes[block_count++];
+    }
+}
+
+
+/**
+ * Decodes every block, checking the samples against the series if asked
+ * to. Returns the number of errors.
+ */
+int decode(int check)
+{
+    struct gorilla_decoder decoder;
+    struct sample sample;
+    struct series * s = NULL;
+    const uint8_t * block = blocks;
+    int64_t time;
+    size_t index = 0;
+    unsigned int sensor = 0;
+    int errors = 0;
+    size_t i;
+    int ret;
+
+    for (i = 0; i < block_count; i++) {
+        gorilla_decoder_init(&decoder, block, block_sizes[i]);
+        if (decoder.sensor != sensor) {
+            sensor = decoder.sensor;
+            s = &series[sensor - 1];
+            index = 0;
+        }
+        while ((ret = gorilla_next(&decoder, &time, &sample)) == 1) {
+            if (check && (time != s->times[index] || sample.measure != s->samples[index].measure
+                    || sample.value.mantissa != s->samples[index].value.mantissa
+                    || sample.value.scale != s->samples[index].value.scale)) {
+                errors++;
+            }
+            index++;
+        }
+        if (ret < 0) {
+            errors++;
+        }
+        block += block_sizes[i];
+    }
+
+    return errors;
+}
+
+
+int main(int argc, char ** argv)
+{
+    size_t samples = DEFAULT_SAMPLES;
+    double raw, text, elapsed;
+    int j;
+
+    if (argc > 2) {
+        printf("Usage: %s [SAMPLES]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (argc == 2) {
+        samples = atol(argv[1]);
+    }
+    samples -= samples % SENSORS;
+
+    build_series(samples);
+    // Blocks never get bigger than the raw records
+    blocks = allocate(samples * sizeof(struct journal_record) + SENSORS * BLOCK_SIZE);
+    block_sizes = allocate((samples + SENSORS) * sizeof(*block_sizes));
+
+    encode();
+    if (decode(1) != 0) {
+        printf("Decoded samples differ from the encoded ones\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // " + New value received from sensor: 1 123456 0072.055\n"
+    raw = (double)samples * sizeof(struct journal_record);
+    text = (double)samples * 52;
+    printf("%zu samples of %d sensors in %zu blocks of up to %d bytes\n",
+            samples, SENSORS, block_count, BLOCK_SIZE);
+    printf("  %.2f bytes/sample, ratio %.1fx over journal records, %.1fx over text\n",
+            (double)block_bytes / samples, raw / block_bytes, text / block_bytes);
+
+    for (j = 0; j < 2; j++) {
+        elapsed = now();
+        if (j == 0) {
+            encode();
+        } else {
+            decode(0);
+        }
+        elapsed = now() - elapsed;
+        printf("  %s %8.1f MB/s %8.1f ns/sample\n", j == 0 ? "encode" : "decode",
+                raw / elapsed / 1e6, elapsed * 1e9 / samples);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,445 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/ptrace.h>
+
+#include "sim.h"
+#include "histogram.h"
+
+
+/**
+ * Runs acquisition variants, one at a time, against a simulated sensor and
+ * compares what they cost for a sweep of response delays and of requests
+ * left unanswered. For every run:
+ *  - samples/s: well-formed responses consumed per second
+ *  - p50/p99: turnaround of the application, from a response written to
+ *    the next "get" read, which includes the wait for a timeout after a
+ *    lost request (request/response variants only)
+ *  - CPU time, from the rusage of the application
+ *  - syscalls per sample: every system call of the application, poll,
+ *    epoll_wait, nanosleep and sigsuspend as much as read and write. The
+ *    kernel keeps no total count, they are counted under ptrace in a
+ *    second run of the same point, whose stops would skew every other
+ *    figure
+ *  - wakeups/s: voluntary context switches of the application
+ *
+ * An APP is a command line, the device path being appended to it, e.g.
+ * "./host_app_acquire -s poll". Variants which do not send "get" (the
+ * engine with -l) are given with -s and fed a stream of one frame every
+ * DELAY ms, lost frames being skipped.
+ *
+ * Usage: bench.modes [-d DELAYS] [-l DROPS] [-t DURATION] [-o CSV]
+ *                    [-s STREAMING-APP]... APP...
+ */
+
+#define CHECKERR(val, fmt, ...) {               \
+    if ((val) < 0) {                            \
+        fprintf(stderr, fmt": ", __VA_ARGS__);  \
+        perror(NULL);                           \
+        exit(EXIT_FAILURE);                     \
+    }                                           \
+}
+
+#define MAX_APPS 16
+#define MAX_ARGS 16
+#define MAX_POINTS 16
+#define DEFAULT_DURATION 3000
+#define EXIT_GRACE 1000
+
+
+struct app {
+    const char * command;
+    const char * name;
+    int streaming;
+};
+
+struct result {
+    unsigned long samples;
+    double rate;
+    double p50;                 // In ms
+    double p99;                 // In ms
+    double cpu;                 // In ms
+    double syscalls;
+    double wakeups;
+};
+
+static struct app apps[MAX_APPS];
+static int app_count = 0;
+
+// Turnaround of the current run
+static struct histogram turnaround;
+static long long last_written;
+static long long first_written;
+
+// Syscall stops of the traced application, shared with its tracer
+static volatile unsigned long long * stops;
+static pid_t tracee;
+
+
+long long now_us()
+{
+    struct timespec ts;
+
+    CHECKERR(clock_gettime(CLOCK_MONOTONIC, &ts), "Couldn't read clock (%d)", CLOCK_MONOTONIC);
+
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+void on_response(struct sim_device * dev, long long requested)
+{
+    long long now = now_us();
+
+    (void)dev;
+    if (last_written > 0 && requested > last_written) {
+        histogram_record(&turnaround, requested - last_written);
+    }
+    if (first_written == 0) {
+        first_written = now;
+    }
+    last_written = now;
+}
+
+
+/**
+ * Parses a comma separated list of integers, returns how many were read.
+ */
+int parse_list(char * arg, int * values)
+{
+    char * token;
+    int count = 0;
+
+    for (token = strtok(arg, ","); token != NULL && count < MAX_POINTS; token = strtok(NULL, ",")) {
+        values[count++] = atoi(token);
+    }
+    return count;
+}
+
+
+void add_app(const char * command, int streaming)
+{
+    const char * name = command;
+    const char * p;
+
+    if (app_count == MAX_APPS) {
+        return;
+    }
+    // Name it after the command line, without the directory
+    for (p = command; *p != '\0' && *p != ' '; p++) {
+        if (*p == '/') {
+            name = p + 1;
+        }
+    }
+    apps[app_count].command = command;
+    apps[app_count].name = name;
+    apps[app_count].streaming = streaming;
+    app_count++;
+}
+
+
+/**
+ * Replaces the process with the application, its output discarded.
+ */
+void execute(struct app * app, const char * path)
+{
+    char command[256];
+    char * args[MAX_ARGS + 2];
+    int null;
+    int i;
+
+    null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    dup2(null, STDERR_FILENO);
+    close(null);
+    snprintf(command, sizeof(command), "%s", app->command);
+    args[0] = strtok(command, " ");
+    for (i = 0; args[i] != NULL && i < MAX_ARGS; i++) {
+        args[i + 1] = strtok(NULL, " ");
+    }
+    args[i++] = (char *)path;
+    args[i] = NULL;
+    execv(args[0], args);
+    _exit(127);
+}
+
+
+void forward(int sig)
+{
+    kill(tracee, sig);
+}
+
+
+/**
+ * Runs the application as a child traced at every system call of every
+ * thread, and counts the stops, one on entry and one on exit, in *stops.
+ * Signals to the tracer are forwarded to the application, which is killed
+ * with it. Never returns.
+ */
+void trace(struct app * app, const char * path)
+{
+    struct sigaction sa;
+    pid_t pid;
+    int status, sig;
+
+    tracee = fork();
+    if (tracee < 0) {
+        _exit(127);
+    }
+    if (tracee == 0) {
+        ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+        execute(app, path);
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = forward;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    // Stopped by the exec
+    if (waitpid(tracee, &status, 0) < 0 || !WIFSTOPPED(status)) {
+        _exit(127);
+    }
+    ptrace(PTRACE_SETOPTIONS, tracee, NULL,
+            PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | PTRACE_O_EXITKILL);
+    ptrace(PTRACE_SYSCALL, tracee, NULL, NULL);
+
+    while ((pid = waitpid(-1, &status, __WALL)) >= 0 || errno == EINTR) {
+        if (pid < 0 || !WIFSTOPPED(status)) {
+            continue;
+        }
+        sig = WSTOPSIG(status);
+        if (sig == (SIGTRAP | 0x80)) {
+            (*stops)++;
+            sig = 0;
+        } else if (sig == SIGTRAP || sig == SIGSTOP) {
+            // A new thread, or the event of its creation
+            sig = 0;
+        }
+        ptrace(PTRACE_SYSCALL, pid, NULL, sig);
+    }
+    _exit(0);
+}
+
+
+/**
+ * Stops the application with SIGINT, as an operator would, and kills it if
+ * it does not exit in time (e.g. stuck in a read without timeout).
+ */
+void stop_app(pid_t pid, struct rusage * usage)
+{
+    long long deadline = now_us() + EXIT_GRACE * 1000LL;
+    int status;
+
+    kill(pid, SIGINT);
+    while (wait4(pid, &status, WNOHANG, usage) == 0) {
+        if (now_us() > deadline) {
+            kill(pid, SIGKILL);
+            CHECKERR(wait4(pid, &status, 0, usage), "Failed to wait for %d", (int)pid);
+            return;
+        }
+        usleep(10000);
+    }
+}
+
+
+/**
+ * Runs the application against a simulated device for duration ms, and
+ * fills result in but its syscalls if traced is 0, only those otherwise.
+ */
+void session(struct app * app, const struct sim_config * config, long duration, int traced,
+        struct result * result)
+{
+    struct sim sim;
+    struct rusage usage;
+    unsigned long long calls;
+    volatile int stop = 0;
+    long long end;
+    double cpu;
+    pid_t pid;
+
+    CHECKERR(sim_init(&sim, config, 1), "Failed to create simulated device for %s", app->name);
+    sim.on_response = on_response;
+
+    histogram_init(&turnaround);
+    last_written = 0;
+    first_written = 0;
+    *stops = 0;
+
+    pid = fork();
+    CHECKERR(pid, "Failed to fork for %s", app->name);
+    if (pid == 0) {
+        close(sim.devices[0].master);
+        close(sim.devices[0].slave);
+        close(sim.epfd);
+        if (traced) {
+            trace(app, sim.devices[0].path);
+        }
+        execute(app, sim.devices[0].path);
+    }
+
+    CHECKERR(sim_run(&sim, &stop, duration), "Simulation failed for %s", app->name);
+
+    // Before the application is stopped, which may take up to EXIT_GRACE
+    end = now_us();
+    calls = (*stops + 1) / 2;
+    stop_app(pid, &usage);
+
+    if (traced) {
+        result->syscalls = sim.stats.responses > 0 ? (double)calls / sim.stats.responses : 0;
+        sim_close(&sim);
+        return;
+    }
+
+    cpu = usage.ru_utime.tv_sec * 1e3 + usage.ru_utime.tv_usec / 1e3
+        + usage.ru_stime.tv_sec * 1e3 + usage.ru_stime.tv_usec / 1e3;
+
+    result->samples = sim.stats.responses;
+    result->rate = first_written > 0 ? result->samples * 1e6 / (end - first_written) : 0;
+    result->p50 = app->streaming || turnaround.count == 0 ? -1 : histogram_quantile(&turnaround, 500) / 1e3;
+    result->p99 = app->streaming || turnaround.count == 0 ? -1 : histogram_quantile(&turnaround, 990) / 1e3;
+    result->cpu = cpu;
+    result->wakeups = usage.ru_nvcsw * 1e3 / duration;
+
+    sim_close(&sim);
+}
+
+
+void run(struct app * app, int delay, int drop, long duration, struct result * result)
+{
+    struct sim_config config;
+
+    memset(&config, 0, sizeof(config));
+    config.delay = delay;
+    config.drop = drop * 10;
+    if (app->streaming) {
+        config.rate = delay > 0 ? 1000 / delay : 1000;
+    }
+
+    session(app, &config, duration, 0, result);
+    session(app, &config, duration, 1, result);
+}
+
+
+/**
+ * Prints a latency for the table, or a dash where it does not apply.
+ */
+void print_latency(double value)
+{
+    if (value < 0) {
+        printf(" %8s", "-");
+    } else {
+        printf(" %8.2f", value);
+    }
+}
+
+
+void print_csv_latency(FILE * csv, double value)
+{
+    if (value >= 0) {
+        fprintf(csv, "%.3f", value);
+    }
+}
+
+
+void usage(const char * name)
+{
+    printf("Usage: %s [-d DELAYS] [-l DROPS] [-t DURATION] [-o CSV] [-s STREAMING-APP]... APP...\n", name);
+    printf("  -d  Comma separated response delays in ms (default 1,15,50)\n");
+    printf("  -l  Comma separated rates of requests left unanswered in %% (default 0,1,5)\n");
+    printf("  -t  Duration of every run in ms (default %d)\n", DEFAULT_DURATION);
+    printf("  -o  Also write the results to CSV\n");
+    printf("  -s  Application which streams instead of sending \"get\"\n");
+    exit(EXIT_FAILURE);
+}
+
+
+int main(int argc, char ** argv)
+{
+    char default_delays[] = "1,15,50";
+    char default_drops[] = "0,1,5";
+    int delays[MAX_POINTS];
+    int drops[MAX_POINTS];
+    int delay_count = parse_list(default_delays, delays);
+    int drop_count = parse_list(default_drops, drops);
+    long duration = DEFAULT_DURATION;
+    const char * csv_path = NULL;
+    struct result result;
+    FILE * csv = NULL;
+    int opt;
+    int a, d, l;
+
+    while ((opt = getopt(argc, argv, "d:l:t:o:s:")) != -1) {
+        switch (opt) {
+            case 'd': delay_count = parse_list(optarg, delays); break;
+            case 'l': drop_count = parse_list(optarg, drops); break;
+            case 't': duration = atol(optarg); break;
+            case 'o': csv_path = optarg; break;
+            case 's': add_app(optarg, 1); break;
+            default: usage(argv[0]);
+        }
+    }
+    for (a = optind; a < argc; a++) {
+        add_app(argv[a], 0);
+    }
+
+    if (app_count == 0 || delay_count == 0 || drop_count == 0 || duration <= 0) {
+        usage(argv[0]);
+    }
+
+    stops = mmap(NULL, sizeof(*stops), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (stops == MAP_FAILED) {
+        CHECKERR(-1, "Couldn't map the %s counter", "syscall");
+    }
+
+    if (csv_path != NULL) {
+        csv = fopen(csv_path, "w");
+        if (csv == NULL) {
+            CHECKERR(-1, "Couldn't open %s", csv_path);
+        }
+        fprintf(csv, "mode,delay_ms,drop_pct,duration_ms,samples,samples_per_s,"
+                "p50_ms,p99_ms,cpu_ms,syscalls_per_sample,wakeups_per_s\n");
+    }
+
+    printf("%-28s %6s %5s %8s %9s %8s %8s %8s %9s %9s\n", "mode", "delay", "drop",
+            "samples", "samples/s", "p50 ms", "p99 ms", "cpu ms", "sys/samp", "wakeup/s");
+
+    for (a = 0; a < app_count; a++) {
+        for (d = 0; d < delay_count; d++) {
+            for (l = 0; l < drop_count; l++) {
+                run(&apps[a], delays[d], drops[l], duration, &result);
+
+                printf("%-28s %6d %4d%% %8lu %9.1f", apps[a].name, delays[d], drops[l],
+                        result.samples, result.rate);
+                print_latency(result.p50);
+                print_latency(result.p99);
+                printf(" %8.1f %9.2f %9.1f\n", result.cpu, result.syscalls, result.wakeups);
+                fflush(stdout);
+
+                if (csv != NULL) {
+                    fprintf(csv, "%s,%d,%d,%ld,%lu,%.3f,", apps[a].name, delays[d], drops[l],
+                            duration, result.samples, result.rate);
+                    print_csv_latency(csv, result.p50);
+                    fprintf(csv, ",");
+                    print_csv_latency(csv, result.p99);
+                    fprintf(csv, ",%.3f,%.3f,%.3f\n", result.cpu, result.syscalls, result.wakeups);
+                }
+            }
+        }
+    }
+
+    if (csv != NULL) {
+        fclose(csv);
+    }
+
+    return EXIT_SUCCESS;
+}
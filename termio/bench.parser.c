@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "parser.h"
+
+
+/**
+ * Microbenchmark of parse_frame() against the sscanf() based validation
+ * previously used by every acquisition variant.
+ *
+ * Usage: bench.parser [ITERATIONS]
+ */
+
+#define CORPUS_SIZE 4096
+#define FRAME_SIZE 51
+#define DEFAULT_ITERATIONS 200
+
+
+struct corpus {
+    const char * name;
+    char frames[CORPUS_SIZE][FRAME_SIZE];
+    size_t lengths[CORPUS_SIZE];
+    size_t bytes;
+};
+
+static struct corpus valid = { "valid", {{0}}, {0}, 0 };
+static struct corpus malformed = { "malformed", {{0}}, {0}, 0 };
+
+static volatile double sink;
+
+
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+void add_frame(struct corpus * c, int i)
+{
+    c->lengths[i] = strlen(c->frames[i]);
+    c->bytes += c->lengths[i];
+}
+
+
+void build_corpora()
+{
+    char * frame;
+    int i;
+
+    srand(42);
+
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        snprintf(valid.frames[i], FRAME_SIZE, "StringFromSensor%d_%d_%.3f\n",
+                rand() % 64, i, (rand() % 2000000 - 1000000) / 1000.0);
+        add_frame(&valid, i);
+
+        frame = malformed.frames[i];
+
+        switch (i % 5) {
+            case 0:
+                snprintf(frame, FRAME_SIZE, "StringFromSenzor%d_%d_%.3f\n", i % 64, i, i / 7.0);
+                break;
+            case 1:
+                snprintf(frame, FRAME_SIZE, "StringFromSensor%d_99999999999_%.3f\n", i % 64, i / 7.0);
+                break;
+            case 2:
+                snprintf(frame, FRAME_SIZE, "StringFromSensor%d_%d_", i % 64, i);
+                break;
+            case 3:
+                snprintf(frame, FRAME_SIZE, "StringFromSensor%d_%d_%.3fxyz\n", i % 64, i, i / 7.0);
+                break;
+            default:
+                snprintf(frame, FRAME_SIZE, "StringFromSensor%d_%dx_%.3f\n", i % 64, i, i / 7.0);
+        }
+        add_frame(&malformed, i);
+    }
+}
+
+
+int run_sscanf(struct corpus * c)
+{
+    unsigned int sensor;
+    unsigned int measure;
+    double value;
+    int accepted = 0;
+    int i;
+
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        if (sscanf(c->frames[i], "StringFromSensor%u_%u_%lf\n", &sensor, &measure, &value) == 3) {
+            sink += value + sensor + measure;
+            accepted++;
+        }
+    }
+
+    return accepted;
+}
+
+
+int run_parser(struct corpus * c)
+{
+    struct sample sample;
+    int accepted = 0;
+    int i;
+
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        if (parse_frame(c->frames[i], c->lengths[i], &sample) == PARSE_OK) {
+            sink += sample.value.mantissa + sample.sensor + sample.measure;
+            accepted++;
+        }
+    }
+
+    return accepted;
+}
+
+
+void bench(struct corpus * c, const char * name, int (*run)(struct corpus *), int iterations)
+{
+    double start, elapsed;
+    int accepted = 0;
+    int i;
+
+    start = now();
+    for (i = 0; i < iterations; i++) {
+        accepted = run(c);
+    }
+    elapsed = now() - start;
+
+    printf("%-10s %-8s %6d/%d accepted %10.1f ns/frame %10.2f MB/s\n",
+            c->name, name, accepted, CORPUS_SIZE,
+            elapsed * 1e9 / ((double)iterations * CORPUS_SIZE),
+            (double)c->bytes * iterations / elapsed / 1e6);
+}
+
+
+/**
+ * Both parsers have to agree on every well-formed frame.
+ */
+int check()
+{
+    struct sample sample;
+    unsigned int sensor;
+    unsigned int measure;
+    double value;
+    int errors = 0;
+    int i;
+
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        sscanf(valid.frames[i], "StringFromSensor%u_%u_%lf\n", &sensor, &measure, &value);
+        if (parse_frame(valid.frames[i], valid.lengths[i], &sample) != PARSE_OK
+                || sample.sensor != sensor || sample.measure != measure
+                || fixed_to_double(sample.value) != value) {
+            printf("Mismatch on frame %d: %s", i, valid.frames[i]);
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+
+int main(int argc, char ** argv)
+{
+    int iterations = DEFAULT_ITERATIONS;
+
+    if (argc > 2) {
+        printf("Usage: %s [ITERATIONS]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (argc == 2) {
+        iterations = atoi(argv[1]);
+    }
+
+    build_corpora();
+
+    if (check()) {
+        exit(EXIT_FAILURE);
+    }
+
+    bench(&valid, "sscanf", run_sscanf, iterations);
+    bench(&valid, "parser", run_parser, iterations);
+    bench(&malformed, "sscanf", run_sscanf, iterations);
+    bench(&malformed, "parser", run_parser, iterations);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "parser.h"
+#include "sink.h"
+
+
+/**
+ * Microbenchmark of the output sink against the printf() every sample
+ * used to go through, writing to /dev/null so that only the formatting
+ * and the system calls are measured.
+ *
+ * Usage: bench.sink [ITERATIONS]
+ */
+
+#define CORPUS_SIZE 4096
+#define FRAME_SIZE 51
+#define DEFAULT_ITERATIONS 200
+
+
+static struct sample samples[CORPUS_SIZE];
+static struct sink sink;
+
+
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/**
+ * Samples as the parser gives them, from frames with three decimals.
+ */
+void build_corpus()
+{
+    char frame[FRAME_SIZE];
+    int i;
+
+    srand(42);
+
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        snprintf(frame, FRAME_SIZE, "StringFromSensor%d_%d_%.3f\n",
+                rand() % 64, i, (rand() % 2000000 - 1000000) / 1000.0);
+        parse_frame(frame, strlen(frame), &samples[i]);
+    }
+}
+
+
+void run_printf(FILE * out)
+{
+    int i;
+
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        fprintf(out, " + New value received from sensor: %u %u %08.3f\n",
+                samples[i].sensor, samples[i].measure, fixed_to_double(samples[i].value));
+    }
+}
+
+
+void run_sink()
+{
+    int i;
+
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        sink_sample(&sink, &samples[i]);
+    }
+}
+
+
+void report(const char * name, double elapsed, int iterations, unsigned long writes)
+{
+    printf("%-8s %10.1f ns/sample", name, elapsed * 1e9 / ((double)iterations * CORPUS_SIZE));
+    if (writes > 0) {
+        printf(" %10.1f samples/write", (double)iterations * CORPUS_SIZE / writes);
+    }
+    printf("\n");
+}
+
+
+void bench_printf(const char * name, int mode, int iterations)
+{
+    FILE * out = fopen("/dev/null", "w");
+    double start;
+    int i;
+
+    if (out == NULL) {
+        perror("Failed to open /dev/null");
+        exit(EXIT_FAILURE);
+    }
+    setvbuf(out, NULL, mode, BUFSIZ);
+
+    start = now();
+    for (i = 0; i < iterations; i++) {
+        run_printf(out);
+    }
+    fflush(out);
+    report(name, now() - start, iterations, mode == _IOLBF ? (unsigned long)iterations * CORPUS_SIZE : 0);
+    fclose(out);
+}
+
+
+/**
+ * The human format has to match printf() byte for byte.
+ */
+int check()
+{
+    char expected[CORPUS_SIZE * 64];
+    char output[CORPUS_SIZE * 64];
+    FILE * tmp = tmpfile();
+    size_t len = 0;
+    ssize_t size;
+    int i;
+
+    if (tmp == NULL) {
+        perror("Failed to create temporary file");
+        return -1;
+    }
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        len += snprintf(expected + len, sizeof(expected) - len,
+                " + New value received from sensor: %u %u %08.3f\n",
+                samples[i].sensor, samples[i].measure, fixed_to_double(samples[i].value));
+    }
+
+    sink_init(&sink, fileno(tmp), SINK_HUMAN, SINK_THRESHOLD, SINK_DELAY);
+    run_sink();
+    sink_flush(&sink);
+
+    size = pread(fileno(tmp), output, sizeof(output), 0);
+    fclose(tmp);
+    if (size != (ssize_t)len || memcmp(output, expected, len) != 0) {
+        printf("Human format differs from printf (%zd bytes instead of %zu)\n", size, len);
+        return -1;
+    }
+    return 0;
+}
+
+
+int main(int argc, char ** argv)
+{
+    static const enum sink_format formats[] = { SINK_HUMAN, SINK_CSV, SINK_JSON, SINK_BINARY };
+    int iterations = DEFAULT_ITERATIONS;
+    double start;
+    int fd;
+    int i, j;
+
+    if (argc > 2) {
+        printf("Usage: %s [ITERATIONS]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (argc == 2) {
+        iterations = atoi(argv[1]);
+    }
+
+    build_corpus();
+
+    if (check() < 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    // Line buffered, like stdout on a terminal, then fully buffered
+    bench_printf("printf", _IOLBF, iterations);
+    bench_printf("printf/f", _IOFBF, iterations);
+
+    fd = open("/dev/null", O_WRONLY);
+    if (fd < 0) {
+        perror("Failed to open /dev/null");
+        exit(EXIT_FAILURE);
+    }
+    for (j = 0; j < (int)(sizeof(formats) / sizeof(formats[0])); j++) {
+        sink_init(&sink, fd, formats[j], SINK_THRESHOLD, SINK_DELAY);
+        start = now();
+        for (i = 0; i < iterations; i++) {
+            run_sink();
+        }
+        sink_flush(&sink);
+        report(sink_format_name(formats[j]), now() - start, iterations, sink.flushes);
+    }
+    close(fd);
+
+    return EXIT_SUCCESS;
+}
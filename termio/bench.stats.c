@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "parser.h"
+#include "stats.h"
+
+
+/**
+ * Cost per sample of the running statistics, and accuracy of their
+ * quantiles: the rank of every estimate is looked up among the sorted
+ * values, on a single series and on the merge of two halves of it saved
+ * to a snapshot and loaded back.
+ *
+ * Usage: bench.stats [SAMPLES]
+ */
+
+#define SENSOR 3
+#define DEFAULT_SAMPLES 1000000
+
+
+static struct stats whole;
+static struct stats halves;
+static struct stats merged;
+static int64_t * values;
+static int64_t * sorted;
+
+static const unsigned int permilles[] = { 10, 100, 250, 500, 750, 900, 950, 990, 999 };
+#define QUANTILES (sizeof(permilles) / sizeof(permilles[0]))
+
+
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static int compare(const void * a, const void * b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+
+/**
+ * A slowly drifting value with heavy-tailed noise, three decimals.
+ */
+void generate(size_t samples)
+{
+    int64_t drift = 50000;
+    size_t i;
+
+    srand(42);
+    for (i = 0; i < samples; i++) {
+        drift += rand() % 21 - 10;
+        values[i] = drift + (rand() % 1000 == 0 ? rand() % 20000 : rand() % 401 - 200);
+    }
+    memcpy(sorted, values, samples * sizeof(*values));
+    qsort(sorted, samples, sizeof(*sorted), compare);
+}
+
+
+void feed(struct stats * stats, size_t from, size_t to)
+{
+    struct sample sample;
+    size_t i;
+
+    sample.sensor = SENSOR;
+    sample.value.scale = 3;
+    for (i = from; i < to; i++) {
+        sample.measure = i + 1;
+        sample.value.mantissa = values[i];
+        if (stats_add(stats, &sample) < 0) {
+            perror("Failed to add");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+
+/**
+ * Prints the rank error of every quantile, in % of the samples, and
+ * returns the largest.
+ */
+double accuracy(const char * name, const struct stats * stats, size_t samples)
+{
+    const struct stats_series * series = stats_find(stats, SENSOR);
+    int64_t estimates[QUANTILES];
+    double error, worst = 0;
+    size_t low, high;
+    unsigned int i;
+
+    stats_quantiles(series, permilles, estimates, QUANTILES);
+    printf("  %-8s", name);
+    for (i = 0; i < QUANTILES; i++) {
+        // Ranks holding the estimate, whichever is closest counts
+        low = 0;
+        while (low < samples && sorted[low] < estimates[i]) {
+            low++;
+        }
+        high = low;
+        while (high < samples && sorted[high] == estimates[i]) {
+            high++;
+        }
+        error = permilles[i] * (double)samples / 1000;
+        if (error < low) {
+            error = low - error;
+        } else if (error > high) {
+            error = error - high;
+        } else {
+            error = 0;
+        }
+        error = error * 100 / samples;
+        printf(" p%-4.1f %5.2f%%", permilles[i] / 10.0, error);
+        worst = error > worst ? error : worst;
+    }
+    printf("\n");
+    return worst;
+}
+
+
+int main(int argc, char ** argv)
+{
+    char path[] = "/tmp/bench.stats.XXXXXX";
+    const struct stats_series * a;
+    const struct stats_series * b;
+    size_t samples = DEFAULT_SAMPLES;
+    double start;
+    int fd;
+
+    if (argc > 2) {
+        printf("Usage: %s [SAMPLES]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (argc == 2) {
+        samples = atol(argv[1]);
+    }
+    values = malloc(samples * sizeof(*values));
+    sorted = malloc(samples * sizeof(*sorted));
+    if (values == NULL || sorted == NULL) {
+        perror("Failed to allocate");
+        exit(EXIT_FAILURE);
+    }
+    generate(samples);
+
+    stats_init(&whole);
+    start = now();
+    feed(&whole, 0, samples);
+    printf("%zu samples added in %.1f ns each, %u sketch items in %u levels (%zu bytes a series)\n",
+            samples, (now() - start) * 1e9 / samples, whole.series[0].sketch.used,
+            whole.series[0].sketch.levels, sizeof(struct stats_series));
+
+    // Two halves, one of them going through a snapshot
+    stats_init(&halves);
+    stats_init(&merged);
+    feed(&halves, 0, samples / 2);
+    feed(&merged, samples / 2, samples);
+    fd = mkstemp(path);
+    if (fd < 0 || stats_save(&halves, path) < 0 || stats_load(&merged, path) < 0) {
+        perror("Failed to go through a snapshot");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+    unlink(path);
+
+    a = stats_find(&whole, SENSOR);
+    b = stats_find(&merged, SENSOR);
+    if (a->count != b->count || a->min != b->min || a->max != b->max
+            || fabs(stats_mean(a) - stats_mean(b)) > 1e-9 * fabs(stats_mean(a))
+            || fabs(stats_stddev(a) - stats_stddev(b)) > 1e-9 * stats_stddev(a)) {
+        printf("Merged halves differ from the whole\n");
+        exit(EXIT_FAILURE);
+    }
+    printf("  mean %.4f stddev %.4f, merged halves agree\n", stats_mean(a), stats_stddev(a));
+
+    printf("Rank error of the quantiles:\n");
+    accuracy("whole", &whole, samples);
+    accuracy("merged", &merged, samples);
+
+    start = now();
+    stats_print(stdout, &whole, "  sensor");
+    printf("  printed in %.1f us\n", (now() - start) * 1e6);
+
+    return EXIT_SUCCESS;
+}
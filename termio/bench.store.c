@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "parser.h"
+#include "store.h"
+
+
+/**
+ * Queries over a day of 10 Hz samples of a sensor held in the store:
+ * downsampling to hours and to minutes, a one minute range and scan, and
+ * the last samples. Results are checked against a plain scan of the
+ * generated columns first, as is what reads back from a store small
+ * enough to recycle its chunks.
+ *
+ * Usage: bench.store [ITERATIONS]
+ */
+
+#define PERIOD 100000LL
+#define DAY (24 * 3600 * 1000000LL)
+#define SAMPLES (DAY / PERIOD)
+#define HOUR (3600 * 1000000LL)
+#define MINUTE (60 * 1000000LL)
+#define DEFAULT_ITERATIONS 100
+
+#define SENSOR 7
+
+
+static struct store store;
+static struct store small;
+static int64_t times[SAMPLES];
+static int64_t values[SAMPLES];
+static struct store_bucket buckets[24 * 60];
+
+// Of the last query, against the optimizer
+static volatile size_t result;
+
+
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+void generate()
+{
+    int64_t time = 0;
+    int64_t value = 50000;
+    long i;
+
+    srand(42);
+    for (i = 0; i < SAMPLES; i++) {
+        time += PERIOD + rand() % 2001 - 1000;
+        value += rand() % 41 - 20;
+        times[i] = time;
+        values[i] = value;
+    }
+}
+
+
+/**
+ * Appends the first count samples of the columns, the measure being the
+ * index plus one.
+ */
+void fill(struct store * target, size_t budget, long count)
+{
+    struct sample sample;
+    long i;
+
+    store_init(target, budget);
+    sample.sensor = SENSOR;
+    sample.value.scale = 3;
+    for (i = 0; i < count; i++) {
+        sample.measure = i + 1;
+        sample.value.mantissa = values[i];
+        if (store_append(target, times[i], &sample) < 0) {
+            perror("Failed to append");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+
+struct cursor {
+    long next;                      // Index of the sample expected
+    long errors;
+};
+
+
+int verify(int64_t time, int64_t value, uint32_t measure, void * arg)
+{
+    struct cursor * cursor = arg;
+    long i = cursor->next++;
+
+    if (i >= SAMPLES || time != times[i] || value != values[i] || measure != (uint32_t)(i + 1)) {
+        cursor->errors++;
+    }
+    return 0;
+}
+
+
+int count_sample(int64_t time, int64_t value, uint32_t measure, void * arg)
+{
+    (void)time;
+    (void)value;
+    (void)measure;
+    (*(size_t *)arg)++;
+    return 0;
+}
+
+
+/**
+ * Index of the first sample of the columns not before t.
+ */
+long column_index(int64_t t)
+{
+    long i = 0;
+
+    while (i < SAMPLES && times[i] < t) {
+        i++;
+    }
+    return i;
+}
+
+
+/**
+ * Reads back what the store holds, which should be the samples [first,
+ * last) of the columns: all of them through a scan, those of a minute in
+ * the middle through a scan and a range, and the last ones.
+ */
+int check_reads(const char * name, const struct store * target, long first, long last)
+{
+    static int64_t out_times[SAMPLES];
+    static int64_t out_values[SAMPLES];
+    struct cursor cursor = { first, 0 };
+    int64_t from = times[(first + last) / 2];
+    int64_t to = from + MINUTE;
+    long low = column_index(from);
+    long high = column_index(to);
+    size_t got, tail;
+
+    got = store_scan(target, SENSOR, INT64_MIN, INT64_MAX, verify, &cursor);
+    if (got != (size_t)(last - first) || cursor.errors > 0) {
+        printf("%s: full scan gives %zu samples, %ld wrong, for %ld\n", name, got, cursor.errors, last - first);
+        return -1;
+    }
+
+    cursor.next = low;
+    got = store_scan(target, SENSOR, from, to, verify, &cursor);
+    if (got != (size_t)(high - low) || cursor.errors > 0) {
+        printf("%s: minute scan gives %zu samples, %ld wrong, for %ld\n", name, got, cursor.errors, high - low);
+        return -1;
+    }
+
+    got = store_range(target, SENSOR, from, to, out_times, out_values, SAMPLES);
+    if (got != (size_t)(high - low) || memcmp(out_times, times + low, got * sizeof(*times)) != 0
+            || memcmp(out_values, values + low, got * sizeof(*values)) != 0) {
+        printf("%s: minute range differs\n", name);
+        return -1;
+    }
+
+    tail = last - first < 100 ? last - first : 100;
+    got = store_last(target, SENSOR, 100, out_times, out_values);
+    if (got != tail || memcmp(out_times, times + last - tail, got * sizeof(*times)) != 0
+            || memcmp(out_values, values + last - tail, got * sizeof(*values)) != 0) {
+        printf("%s: last samples differ\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * Compares the downsampling with a scan of the generated columns.
+ */
+int check(int64_t width)
+{
+    size_t count = store_downsample(&store, SENSOR, 0, DAY, width, buckets, 24 * 60);
+    struct store_bucket expected;
+    size_t b;
+    long i = 0;
+
+    for (b = 0; b < count; b++) {
+        expected.count = 0;
+        expected.min = INT64_MAX;
+        expected.max = INT64_MIN;
+        expected.sum = 0;
+        for (; i < SAMPLES && times[i] < buckets[b].start + width; i++) {
+            expected.count++;
+            expected.min = values[i] < expected.min ? values[i] : expected.min;
+            expected.max = values[i] > expected.max ? values[i] : expected.max;
+            expected.sum += values[i];
+        }
+        if (expected.count != buckets[b].count || expected.sum != buckets[b].sum
+                || (expected.count > 0 && (expected.min != buckets[b].min || expected.max != buckets[b].max))) {
+            printf("Bucket %zu of %lld us differs\n", b, (long long)width);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+void report(const char * name, double start, int iterations)
+{
+    printf("  %-24s %10.2f us\n", name, (now() - start) * 1e6 / iterations);
+}
+
+
+int main(int argc, char ** argv)
+{
+    static int64_t out_times[SAMPLES];
+    static int64_t out_values[SAMPLES];
+    int iterations = DEFAULT_ITERATIONS;
+    long appended = 3 * STORE_CHUNK + STORE_CHUNK / 2;
+    size_t scanned;
+    double start;
+    int i;
+
+    if (argc > 2) {
+        printf("Usage: %s [ITERATIONS]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (argc == 2) {
+        iterations = atoi(argv[1]);
+    }
+
+    generate();
+    start = now();
+    fill(&store, (SAMPLES / STORE_CHUNK + 2) * sizeof(struct store_chunk), SAMPLES);
+    printf("%lld samples appended in %.1f ns each, %zu chunks\n", (long long)SAMPLES,
+            (now() - start) * 1e9 / SAMPLES, store.chunks);
+
+    if (check(HOUR) < 0 || check(MINUTE) < 0 || check(7 * MINUTE + 3) < 0
+            || check_reads("day", &store, 0, SAMPLES) < 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    // Two chunks for three and a half of samples, the oldest recycled
+    fill(&small, 2 * sizeof(struct store_chunk), appended);
+    if (check_reads("recycled", &small, appended - store_find(&small, SENSOR)->count, appended) < 0
+            || small.evicted != appended - store_find(&small, SENSOR)->count) {
+        exit(EXIT_FAILURE);
+    }
+    printf("  read back, %llu of %ld samples recycled in a smaller store\n", small.evicted, appended);
+    store_destroy(&small);
+
+    start = now();
+    for (i = 0; i < iterations; i++) {
+        result = store_downsample(&store, SENSOR, 0, DAY, HOUR, buckets, 24);
+    }
+    report("day in hours", start, iterations);
+
+    start = now();
+    for (i = 0; i < iterations; i++) {
+        result = store_downsample(&store, SENSOR, 0, DAY, MINUTE, buckets, 24 * 60);
+    }
+    report("day in minutes", start, iterations);
+
+    start = now();
+    for (i = 0; i < iterations; i++) {
+        result = store_downsample(&store, SENSOR, 12 * HOUR, 13 * HOUR, MINUTE, buckets, 60);
+    }
+    report("hour in minutes", start, iterations);
+
+    start = now();
+    for (i = 0; i < iterations; i++) {
+        result = store_range(&store, SENSOR, 12 * HOUR, 12 * HOUR + MINUTE, out_times, out_values, SAMPLES);
+    }
+    report("minute range", start, iterations);
+
+    start = now();
+    for (i = 0; i < iterations; i++) {
+        scanned = 0;
+        store_scan(&store, SENSOR, 12 * HOUR, 12 * HOUR + MINUTE, count_sample, &scanned);
+        result = scanned;
+    }
+    report("minute scan", start, iterations);
+
+    start = now();
+    for (i = 0; i < iterations; i++) {
+        result = store_last(&store, SENSOR, 100, out_times, out_values);
+    }
+    report("last 100", start, iterations);
+
+    store_destroy(&store);
+    return EXIT_SUCCESS;
+}
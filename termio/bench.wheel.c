@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "wheel.h"
+
+
+/**
+ * Throughput of the timing wheel, every phase running with at least
+ * TIMERS live timers, a background population armed up front: arm as
+ * many again, cancel them, re-arm the background (the pattern of a
+ * request answered in time), advance over ticks where nothing is due,
+ * then over SPAN ticks where the whole background expires. Expired timers
+ * re-arm themselves past the end, like periodic ones, which keeps the
+ * population steady. The expire cost is per expired timer, net of the
+ * cost of a tick measured in the previous phase. Every expired timer is
+ * checked against the tick it was armed for.
+ *
+ * Usage: bench.wheel [TIMERS [SPAN]]
+ */
+
+#define DEFAULT_TIMERS 100000
+#define DEFAULT_SPAN 100000
+
+
+struct bench_timer {
+    struct timer timer;
+    unsigned long long deadline;
+};
+
+static struct wheel wheel;
+static unsigned long long current;
+static unsigned long long rearm_from;     // Where expired timers go
+static unsigned long span;
+static unsigned long expired = 0;
+static unsigned long errors = 0;
+
+
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+void on_expire(struct timer * timer)
+{
+    struct bench_timer * t = (struct bench_timer *)timer;
+
+    if (t->deadline != current) {
+        errors++;
+    }
+    expired++;
+    t->deadline = rearm_from + rand() % span;
+    wheel_arm(&wheel, timer, t->deadline);
+}
+
+
+void report(const char * name, unsigned long ops, double elapsed)
+{
+    printf("%-8s %9lu ops %10.1f ns/op %8.2f Mops/s, %u live\n", name, ops,
+            elapsed * 1e9 / ops, ops / elapsed / 1e6, wheel.count);
+}
+
+
+int main(int argc, char ** argv)
+{
+    struct bench_timer * timers;
+    struct bench_timer * background;
+    unsigned long count = DEFAULT_TIMERS;
+    unsigned long i;
+    unsigned long long end;
+    double start, tick;
+
+    span = DEFAULT_SPAN;
+    if (argc > 3) {
+        printf("Usage: %s [TIMERS [SPAN]]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (argc > 1) {
+        count = strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        span = strtoul(argv[2], NULL, 10);
+    }
+
+    timers = malloc(2 * count * sizeof(*timers));
+    if (timers == NULL || count == 0 || span == 0) {
+        printf("Invalid parameters\n");
+        exit(EXIT_FAILURE);
+    }
+    background = timers + count;
+
+    srand(42);
+    current = 1000;
+    wheel_init(&wheel, current);
+
+    for (i = 0; i < 2 * count; i++) {
+        timer_init(&timers[i].timer, on_expire);
+        timers[i].deadline = current + 1 + rand() % span;
+    }
+    for (i = 0; i < count; i++) {
+        wheel_arm(&wheel, &background[i].timer, background[i].deadline);
+    }
+
+    start = now();
+    for (i = 0; i < count; i++) {
+        wheel_arm(&wheel, &timers[i].timer, timers[i].deadline);
+    }
+    report("arm", count, now() - start);
+
+    start = now();
+    for (i = 0; i < count; i++) {
+        wheel_cancel(&wheel, &timers[i].timer);
+    }
+    report("cancel", count, now() - start);
+
+    // Past the quiet ticks to come, the expire phase covering them all
+    end = current + span;
+    start = now();
+    for (i = 0; i < count; i++) {
+        background[i].deadline = end + 1 + rand() % span;
+        wheel_arm(&wheel, &background[i].timer, background[i].deadline);
+    }
+    report("rearm", count, now() - start);
+
+    start = now();
+    while (current < end) {
+        current++;
+        wheel_advance(&wheel, current);
+    }
+    tick = (now() - start) / span;
+    report("advance", span, tick * span);
+
+    end = current + span;
+    rearm_from = end + 1;
+    start = now();
+    while (current < end) {
+        current++;
+        wheel_advance(&wheel, current);
+    }
+    report("expire", expired, now() - start - tick * span);
+
+    printf("%lu live timers, %lu expired, %lu expired at the wrong tick\n",
+            (unsigned long)wheel.count, expired, errors);
+
+    free(timers);
+
+    return errors || expired != count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
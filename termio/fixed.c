@@ -0,0 +1,162 @@
+#include <errno.h>
+#include <limits.h>
+
+#include "fixed.h"
+
+
+static const uint64_t powers_of_ten[FIXED_MAX_SCALE + 1] = {
+    1ULL,
+    10ULL,
+    100ULL,
+    1000ULL,
+    10000ULL,
+    100000ULL,
+    1000000ULL,
+    10000000ULL,
+    100000000ULL,
+    1000000000ULL,
+    10000000000ULL,
+    100000000000ULL,
+    1000000000000ULL,
+    10000000000000ULL,
+    100000000000000ULL,
+    1000000000000000ULL,
+    10000000000000000ULL,
+    100000000000000000ULL,
+    1000000000000000000ULL,
+};
+
+// Same, exactly representable as doubles
+static const double double_powers_of_ten[FIXED_MAX_SCALE + 1] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18,
+};
+
+
+/**
+ * Divides by 10^shift, rounding half away from zero.
+ */
+static uint64_t round_down(uint64_t magnitude, int shift)
+{
+    uint64_t divisor = powers_of_ten[shift];
+    uint64_t quotient = magnitude / divisor;
+
+    if ((magnitude - quotient * divisor) * 2 >= divisor) {
+        quotient++;
+    }
+    return quotient;
+}
+
+
+int fixed_rescale(struct fixed * value, int scale)
+{
+    int negative = value->mantissa < 0;
+    uint64_t magnitude = negative ? -(uint64_t)value->mantissa : (uint64_t)value->mantissa;
+    uint64_t factor;
+
+    if (scale < 0 || scale > FIXED_MAX_SCALE) {
+        errno = ERANGE;
+        return -1;
+    }
+
+    if (scale < value->scale) {
+        magnitude = round_down(magnitude, value->scale - scale);
+    } else if (scale > value->scale) {
+        factor = powers_of_ten[scale - value->scale];
+        if (magnitude > (uint64_t)INT64_MAX / factor) {
+            errno = ERANGE;
+            return -1;
+        }
+        magnitude *= factor;
+    }
+    if (magnitude > (uint64_t)INT64_MAX) {
+        errno = ERANGE;
+        return -1;
+    }
+
+    value->mantissa = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+    value->scale = scale;
+    return 0;
+}
+
+
+double fixed_to_double(struct fixed value)
+{
+    return (double)value.mantissa / double_powers_of_ten[value.scale];
+}
+
+
+char * format_uint(char * p, unsigned long long value, int width)
+{
+    char digits[24];
+    unsigned int low;
+    int n = 0;
+
+    // 64-bit divisions are library calls on 32-bit targets, only use them
+    // for what does not fit 32 bits
+    while (value > UINT_MAX) {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    }
+    low = value;
+    do {
+        digits[n++] = '0' + low % 10;
+        low /= 10;
+    } while (low != 0);
+    while (n < width) {
+        *p++ = '0';
+        width--;
+    }
+    while (n > 0) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+
+char * format_fixed(char * p, struct fixed value, int decimals, int width)
+{
+    int negative = value.mantissa < 0;
+    uint64_t magnitude = negative ? -(uint64_t)value.mantissa : (uint64_t)value.mantissa;
+    uint64_t integer, fraction;
+    unsigned int small;
+    int scale = value.scale;
+    int digits;
+
+    if (decimals < 0 || decimals > FIXED_MAX_SCALE) {
+        decimals = decimals < 0 ? scale : FIXED_MAX_SCALE;
+    }
+    if (scale > decimals) {
+        magnitude = round_down(magnitude, scale - decimals);
+        scale = decimals;
+    }
+
+    if (magnitude <= UINT_MAX && scale <= 9) {
+        small = magnitude;
+        integer = small / (unsigned int)powers_of_ten[scale];
+        fraction = small % (unsigned int)powers_of_ten[scale];
+    } else {
+        integer = magnitude / powers_of_ten[scale];
+        fraction = magnitude % powers_of_ten[scale];
+    }
+
+    if (negative) {
+        *p++ = '-';
+        width--;
+    }
+    // The integer part takes what the point and the decimals leave
+    digits = decimals > 0 ? width - decimals - 1 : width;
+    p = format_uint(p, integer, digits > 1 ? digits : 1);
+    if (decimals > 0) {
+        *p++ = '.';
+        if (scale > 0) {
+            p = format_uint(p, fraction, scale);
+        }
+        // Decimals the sensor did not send
+        while (scale < decimals) {
+            *p++ = '0';
+            scale++;
+        }
+    }
+    return p;
+}
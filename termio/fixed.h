@@ -0,0 +1,55 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stdint.h>
+
+
+/**
+ * Decimal fixed-point values: mantissa * 10^-scale. The APF27 has no FPU,
+ * so samples stay in this form from the parser to the output and only
+ * become doubles when a consumer asks for it.
+ *
+ * The scale is the number of decimals the sensor sent, which in practice
+ * is a property of the sensor: values of a given sensor share it and
+ * aggregate as plain integers. Values of different scales are brought to
+ * a common one with fixed_rescale().
+ */
+
+// Largest scale, 10^18 being the largest power of ten an int64_t holds
+#define FIXED_MAX_SCALE 18
+
+
+struct fixed {
+    int64_t mantissa;
+    int scale;
+};
+
+
+/**
+ * Brings value to the given scale, rounding half away from zero when
+ * decimals are dropped. Returns -1 with errno set to ERANGE if the result
+ * does not fit, leaving value untouched.
+ */
+int fixed_rescale(struct fixed * value, int scale);
+
+/**
+ * Converts to floating point, for the consumers which want it.
+ */
+double fixed_to_double(struct fixed value);
+
+/**
+ * Writes the decimal digits of value, at least width of them (zero
+ * padded), and returns the end of what was written. No NUL is added.
+ */
+char * format_uint(char * p, unsigned long long value, int width);
+
+/**
+ * Writes value with the given number of decimals (its own scale if
+ * negative, at most FIXED_MAX_SCALE), zero padded to width characters
+ * including the sign and the point, i.e. what "%0<width>.<decimals>f"
+ * does with its double. Returns the end of what was written, which takes
+ * up to width or 40 bytes, whichever is larger. No NUL is added.
+ */
+char * format_fixed(char * p, struct fixed value, int decimals, int width);
+
+#endif
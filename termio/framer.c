@@ -0,0 +1,120 @@
+#include <string.h>
+
+#include "framer.h"
+
+
+#define MASK (FRAMER_SIZE - 1)
+
+
+void framer_init(struct framer * framer, size_t max_frame)
+{
+    framer->head = 0;
+    framer->tail = 0;
+    framer->scan = 0;
+    framer->max_frame = max_frame;
+    framer->skipping = 0;
+}
+
+
+int framer_iov(struct framer * framer, struct iovec iov[2])
+{
+    unsigned int start = framer->head & MASK;
+    size_t free = FRAMER_SIZE - (framer->head - framer->tail);
+    size_t first = FRAMER_SIZE - start;
+
+    if (free == 0) {
+        return 0;
+    }
+
+    if (free <= first) {
+        iov[0].iov_base = &framer->ring[start];
+        iov[0].iov_len = free;
+        return 1;
+    }
+
+    iov[0].iov_base = &framer->ring[start];
+    iov[0].iov_len = first;
+    iov[1].iov_base = framer->ring;
+    iov[1].iov_len = free - first;
+    return 2;
+}
+
+
+void framer_commit(struct framer * framer, size_t size)
+{
+    framer->head += size;
+}
+
+
+size_t framer_pending(struct framer * framer)
+{
+    return framer->head - framer->tail;
+}
+
+
+/**
+ * Copies len bytes starting at the tail into frame, unwrapping the ring.
+ */
+static void copy_out(struct framer * framer, char * frame, size_t size, size_t len)
+{
+    unsigned int start = framer->tail & MASK;
+    size_t first;
+
+    if (size == 0) {
+        return;
+    }
+    if (len > size - 1) {
+        len = size - 1;
+    }
+
+    first = FRAMER_SIZE - start;
+    if (len <= first) {
+        memcpy(frame, &framer->ring[start], len);
+    } else {
+        memcpy(frame, &framer->ring[start], first);
+        memcpy(frame + first, framer->ring, len - first);
+    }
+    frame[len] = '\0';
+}
+
+
+enum frame_status framer_next(struct framer * framer, char * frame, size_t size, size_t * len)
+{
+    while (1) {
+        // Look for the end of the current frame
+        while (framer->scan != framer->head && framer->ring[framer->scan & MASK] != '\n') {
+            framer->scan++;
+        }
+
+        if (framer->skipping) {
+            // Throw away the rest of an oversize frame
+            if (framer->scan == framer->head) {
+                framer->tail = framer->scan;
+                return FRAME_NONE;
+            }
+            framer->tail = ++framer->scan;
+            framer->skipping = 0;
+            continue;
+        }
+
+        if (framer->scan == framer->head) {
+            if (framer->head - framer->tail < framer->max_frame) {
+                return FRAME_NONE;
+            }
+
+            // No newline in sight, report what we have and resynchronize
+            // on the next one
+            *len = framer->head - framer->tail;
+            copy_out(framer, frame, size, *len);
+            framer->tail = framer->scan;
+            framer->skipping = 1;
+            return FRAME_TOO_LONG;
+        }
+
+        *len = framer->scan + 1 - framer->tail;
+        copy_out(framer, frame, size, *len);
+        framer->tail = ++framer->scan;
+
+        return *len > framer->max_frame ? FRAME_TOO_LONG : FRAME_OK;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef FRAMER_H
+#define FRAMER_H
+
+#include <stddef.h>
+#include <sys/uio.h>
+
+
+// Size of the receive ring, must be a power of two
+#define FRAMER_SIZE 512
+
+
+/**
+ * Circular receive buffer splitting the incoming byte stream into
+ * newline terminated frames. Bytes following a newline stay in the ring
+ * and are carried over to the next frame, nothing is ever dropped except
+ * frames exceeding max_frame bytes.
+ */
+struct framer {
+    char ring[FRAMER_SIZE];
+    unsigned int head;          // Free running write index
+    unsigned int tail;          // Free running read index
+    unsigned int scan;          // Where to resume the newline search
+    size_t max_frame;
+    int skipping;               // Discarding an oversize frame
+};
+
+
+enum frame_status {
+    FRAME_NONE = 0,             // No complete frame buffered yet
+    FRAME_OK,
+    FRAME_TOO_LONG,             // No newline within max_frame bytes
+};
+
+
+/**
+ * Initializes an empty framer. max_frame is the longest accepted frame,
+ * newline included, and must be smaller than FRAMER_SIZE.
+ */
+void framer_init(struct framer * framer, size_t max_frame);
+
+/**
+ * Fills iov with the free space of the ring, ready to be passed to
+ * readv(). Returns the number of vectors used (0 when the ring is full).
+ */
+int framer_iov(struct framer * framer, struct iovec iov[2]);
+
+/**
+ * Accounts for size bytes written into the vectors returned by
+ * framer_iov().
+ */
+void framer_commit(struct framer * framer, size_t size);
+
+/**
+ * Extracts the next complete frame into frame (NUL-terminated, at most
+ * size - 1 bytes copied) and stores its length in len. A FRAME_TOO_LONG
+ * result stores the number of bytes seen so far; the rest of that frame
+ * is then silently skipped up to its newline.
+ */
+enum frame_status framer_next(struct framer * framer, char * frame, size_t size, size_t * len);
+
+/**
+ * Number of bytes buffered but not yet returned as a frame.
+ */
+size_t framer_pending(struct framer * framer);
+
+#endif
@@ -0,0 +1,254 @@
+#include <string.h>
+#include <errno.h>
+
+#include "gorilla.h"
+
+
+// Most bits a sample takes: two 1111-prefixed deltas and a new XOR window
+#define MAX_SAMPLE_BITS (2 * (4 + 64) + 2 + 6 + 6 + 64)
+
+
+static void put_bits(struct gorilla_encoder * encoder, uint64_t value, int bits)
+{
+    uint8_t * byte;
+    int room, take;
+
+    while (bits > 0) {
+        byte = encoder->block + (encoder->bits >> 3);
+        room = 8 - (encoder->bits & 7);
+        take = bits < room ? bits : room;
+        *byte |= ((value >> (bits - take)) & ((1U << take) - 1)) << (room - take);
+        encoder->bits += take;
+        bits -= take;
+    }
+}
+
+
+/**
+ * Returns 0 for a missing bit, the caller checks decoder->bits.
+ */
+static uint64_t get_bits(struct gorilla_decoder * decoder, int bits)
+{
+    uint64_t value = 0;
+    uint8_t byte;
+    int room, take;
+
+    if (decoder->bits + bits > decoder->size * 8) {
+        decoder->bits = decoder->size * 8 + 1;
+        return 0;
+    }
+    while (bits > 0) {
+        byte = decoder->block[decoder->bits >> 3];
+        room = 8 - (decoder->bits & 7);
+        take = bits < room ? bits : room;
+        value = (value << take) | ((byte >> (room - take)) & ((1U << take) - 1));
+        decoder->bits += take;
+        bits -= take;
+    }
+    return value;
+}
+
+
+static void put_delta(struct gorilla_encoder * encoder, int64_t dod)
+{
+    // Zigzag, so that small negative values stay small
+    uint64_t zigzag = ((uint64_t)dod << 1) ^ (uint64_t)(dod >> 63);
+
+    if (zigzag == 0) {
+        put_bits(encoder, 0, 1);
+    } else if (zigzag < (1 << 7)) {
+        put_bits(encoder, 2, 2);
+        put_bits(encoder, zigzag, 7);
+    } else if (zigzag < (1 << 14)) {
+        put_bits(encoder, 6, 3);
+        put_bits(encoder, zigzag, 14);
+    } else if (zigzag < (1 << 20)) {
+        put_bits(encoder, 14, 4);
+        put_bits(encoder, zigzag, 20);
+    } else {
+        put_bits(encoder, 15, 4);
+        put_bits(encoder, zigzag, 64);
+    }
+}
+
+
+static int64_t get_delta(struct gorilla_decoder * decoder)
+{
+    static const int widths[] = { 7, 14, 20, 64 };
+    uint64_t zigzag;
+    int prefix = 0;
+
+    while (prefix < 4 && get_bits(decoder, 1) == 1) {
+        prefix++;
+    }
+    if (prefix == 0) {
+        return 0;
+    }
+    zigzag = get_bits(decoder, widths[prefix - 1]);
+    return (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+}
+
+
+static void put_value(struct gorilla_encoder * encoder, uint64_t value)
+{
+    uint64_t xor = value ^ encoder->value;
+    int leading, trailing;
+
+    encoder->value = value;
+    if (xor == 0) {
+        put_bits(encoder, 0, 1);
+        return;
+    }
+
+    leading = __builtin_clzll(xor);
+    trailing = __builtin_ctzll(xor);
+
+    // Within the previous window, only its bits are stored
+    if (encoder->leading >= 0 && leading >= encoder->leading && trailing >= encoder->trailing) {
+        put_bits(encoder, 2, 2);
+        put_bits(encoder, xor >> encoder->trailing, 64 - encoder->leading - encoder->trailing);
+        return;
+    }
+
+    put_bits(encoder, 3, 2);
+    put_bits(encoder, leading, 6);
+    put_bits(encoder, 64 - leading - trailing - 1, 6);
+    put_bits(encoder, xor >> trailing, 64 - leading - trailing);
+    encoder->leading = leading;
+    encoder->trailing = trailing;
+}
+
+
+static uint64_t get_value(struct gorilla_decoder * decoder)
+{
+    int length;
+
+    if (get_bits(decoder, 1) == 1) {
+        if (get_bits(decoder, 1) == 1) {
+            decoder->leading = get_bits(decoder, 6);
+            length = get_bits(decoder, 6) + 1;
+            decoder->trailing = 64 - decoder->leading - length;
+            if (decoder->trailing < 0) {
+                decoder->trailing = 0;
+                decoder->bits = decoder->size * 8 + 1;
+            }
+        }
+        length = 64 - decoder->leading - decoder->trailing;
+        decoder->value ^= get_bits(decoder, length) << decoder->trailing;
+    }
+    return decoder->value;
+}
+
+
+void gorilla_encoder_init(struct gorilla_encoder * encoder, uint8_t * block, size_t size)
+{
+    memset(encoder, 0, sizeof(*encoder));
+    memset(block, 0, size);
+    encoder->block = block;
+    encoder->size = size;
+    encoder->bits = GORILLA_HEADER * 8;
+    encoder->leading = -1;
+}
+
+
+int gorilla_append(struct gorilla_encoder * encoder, int64_t time, const struct sample * sample)
+{
+    int64_t delta;
+
+    if (encoder->count == GORILLA_MAX_COUNT || encoder->bits + MAX_SAMPLE_BITS > encoder->size * 8) {
+        return 0;
+    }
+
+    if (encoder->count == 0) {
+        encoder->sensor = sample->sensor;
+        encoder->scale = sample->value.scale;
+        put_bits(encoder, time, 64);
+        put_bits(encoder, sample->measure, 32);
+        put_bits(encoder, sample->value.mantissa, 64);
+        encoder->value = sample->value.mantissa;
+    } else {
+        if (sample->sensor != encoder->sensor || sample->value.scale != encoder->scale) {
+            return 0;
+        }
+        delta = time - encoder->time;
+        put_delta(encoder, delta - encoder->time_delta);
+        encoder->time_delta = delta;
+
+        delta = (int64_t)sample->measure - encoder->measure;
+        put_delta(encoder, delta - encoder->measure_delta);
+        encoder->measure_delta = delta;
+
+        put_value(encoder, sample->value.mantissa);
+    }
+
+    encoder->time = time;
+    encoder->measure = sample->measure;
+    encoder->count++;
+    return 1;
+}
+
+
+size_t gorilla_finish(struct gorilla_encoder * encoder)
+{
+    uint8_t * header = encoder->block;
+
+    header[0] = encoder->count & 0xff;
+    header[1] = encoder->count >> 8;
+    header[2] = (uint8_t)encoder->scale;
+    header[3] = 0;
+    header[4] = encoder->sensor & 0xff;
+    header[5] = (encoder->sensor >> 8) & 0xff;
+    header[6] = (encoder->sensor >> 16) & 0xff;
+    header[7] = encoder->sensor >> 24;
+
+    return (encoder->bits + 7) / 8;
+}
+
+
+int gorilla_decoder_init(struct gorilla_decoder * decoder, const uint8_t * block, size_t size)
+{
+    if (size < GORILLA_HEADER) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->block = block;
+    decoder->size = size;
+    decoder->bits = GORILLA_HEADER * 8;
+    decoder->count = block[0] | block[1] << 8;
+    decoder->scale = (int8_t)block[2];
+    decoder->sensor = block[4] | block[5] << 8 | block[6] << 16 | (uint32_t)block[7] << 24;
+    return 0;
+}
+
+
+int gorilla_next(struct gorilla_decoder * decoder, int64_t * time, struct sample * sample)
+{
+    if (decoder->decoded == decoder->count) {
+        return 0;
+    }
+
+    if (decoder->decoded == 0) {
+        decoder->time = get_bits(decoder, 64);
+        decoder->measure = get_bits(decoder, 32);
+        decoder->value = get_bits(decoder, 64);
+    } else {
+        decoder->time_delta += get_delta(decoder);
+        decoder->time += decoder->time_delta;
+        decoder->measure_delta += get_delta(decoder);
+        decoder->measure += decoder->measure_delta;
+        get_value(decoder);
+    }
+    if (decoder->bits > decoder->size * 8) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    decoder->decoded++;
+    *time = decoder->time;
+    sample->sensor = decoder->sensor;
+    sample->measure = decoder->measure;
+    sample->value.mantissa = decoder->value;
+    sample->value.scale = decoder->scale;
+    return 1;
+}
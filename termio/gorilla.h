@@ -0,0 +1,108 @@
+#ifndef GORILLA_H
+#define GORILLA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parser.h"
+
+
+/**
+ * Compressed blocks of the samples of a sensor, after Facebook's Gorilla:
+ * timestamps and measure numbers are stored as deltas of deltas, which
+ * are 0 (a single bit) for a sensor answering at a steady pace with
+ * consecutive measures, and values as the XOR with the previous one,
+ * which only keeps the few bits a slowly changing value flips.
+ *
+ * Values are XORed as fixed-point mantissas, all the samples of a block
+ * share their scale (and their sensor). Timestamps are in us, so the
+ * buckets of the (zigzag encoded) deltas of deltas are wider than those
+ * of Gorilla, which works in seconds:
+ *
+ *   0                      unchanged delta
+ *   10   + 7 bits          zigzag < 2^7
+ *   110  + 14 bits         zigzag < 2^14, within 8 ms of the previous delta
+ *   1110 + 20 bits         zigzag < 2^20
+ *   1111 + 64 bits         anything
+ *
+ * A block starts with an 8-byte header (count and scale on 16 and 8 bits,
+ * a reserved byte, the sensor on 32 bits, all little endian) followed by
+ * the bit stream, most significant bit first.
+ */
+
+#define GORILLA_HEADER 8
+
+// Most samples a block holds, the count being on 16 bits
+#define GORILLA_MAX_COUNT 65535
+
+
+struct gorilla_encoder {
+    uint8_t * block;
+    size_t size;
+    size_t bits;                // Written so far, header included
+
+    unsigned int sensor;
+    int scale;
+    unsigned int count;
+
+    int64_t time;
+    int64_t time_delta;
+    int64_t measure;
+    int64_t measure_delta;
+    uint64_t value;
+    int leading;                // Window of the last XOR written
+    int trailing;
+};
+
+struct gorilla_decoder {
+    const uint8_t * block;
+    size_t size;
+    size_t bits;                // Read so far, header included
+
+    unsigned int sensor;
+    int scale;
+    unsigned int count;
+    unsigned int decoded;
+
+    int64_t time;
+    int64_t time_delta;
+    int64_t measure;
+    int64_t measure_delta;
+    uint64_t value;
+    int leading;
+    int trailing;
+};
+
+
+/**
+ * Starts an empty block in the size bytes at block, which must hold at
+ * least the header.
+ */
+void gorilla_encoder_init(struct gorilla_encoder * encoder, uint8_t * block, size_t size);
+
+/**
+ * Appends a sample received at time (us). Returns 0 if it does not belong
+ * to the block, because the block is full or the sample is of another
+ * sensor or scale: the block is then to be finished and a new one started.
+ * Returns 1 otherwise.
+ */
+int gorilla_append(struct gorilla_encoder * encoder, int64_t time, const struct sample * sample);
+
+/**
+ * Completes the header and returns the number of bytes of the block.
+ */
+size_t gorilla_finish(struct gorilla_encoder * encoder);
+
+/**
+ * Starts decoding the block of size bytes. Returns -1 with errno set to
+ * EINVAL if it is too short to be one.
+ */
+int gorilla_decoder_init(struct gorilla_decoder * decoder, const uint8_t * block, size_t size);
+
+/**
+ * Decodes the next sample and its time. Returns 1 on success, 0 at the end
+ * of the block, and -1 with errno set to EINVAL if the block is truncated.
+ */
+int gorilla_next(struct gorilla_decoder * decoder, int64_t * time, struct sample * sample);
+
+#endif
@@ -0,0 +1,107 @@
+#include <string.h>
+
+#include "histogram.h"
+
+
+/**
+ * Bucket of a value: the exponent selects the power of two, the next
+ * HISTOGRAM_SUB_BITS bits below the most significant one the sub-bucket.
+ * Values below 2 * HISTOGRAM_SUB get a bucket of their own.
+ */
+static unsigned int bucket_of(unsigned int value)
+{
+    int shift = 0;
+
+    if (value >= 2 * HISTOGRAM_SUB) {
+        shift = (31 - __builtin_clz(value)) - HISTOGRAM_SUB_BITS;
+    }
+
+    return shift * HISTOGRAM_SUB + (value >> shift);
+}
+
+
+/**
+ * Highest value falling in a bucket.
+ */
+static unsigned long bucket_high(unsigned int bucket)
+{
+    unsigned int shift;
+
+    if (bucket < 2 * HISTOGRAM_SUB) {
+        return bucket;
+    }
+
+    shift = bucket / HISTOGRAM_SUB - 1;
+    return (((unsigned long long)(bucket - shift * HISTOGRAM_SUB) + 1) << shift) - 1;
+}
+
+
+void histogram_init(struct histogram * histogram)
+{
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+
+void histogram_record(struct histogram * histogram, unsigned long value)
+{
+    if (value > 0xffffffffUL) {
+        value = 0xffffffffUL;
+    }
+
+    if (histogram->count == 0 || value < histogram->min) {
+        histogram->min = value;
+    }
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+
+    histogram->count++;
+    histogram->sum += value;
+    histogram->buckets[bucket_of(value)]++;
+}
+
+
+unsigned long histogram_quantile(struct histogram * histogram, unsigned int permille)
+{
+    unsigned long long target;
+    unsigned long long seen = 0;
+    unsigned int i;
+
+    if (histogram->count == 0) {
+        return 0;
+    }
+
+    target = ((unsigned long long)histogram->count * permille + 999) / 1000;
+    if (target == 0) {
+        target = 1;
+    }
+
+    for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= target) {
+            // The exact extremes are known, do not round them
+            return bucket_high(i) > histogram->max ? histogram->max : bucket_high(i);
+        }
+    }
+
+    return histogram->max;
+}
+
+
+void histogram_print(FILE * stream, struct histogram * histogram, const char * name, double scale)
+{
+    if (histogram->count == 0) {
+        fprintf(stream, "%s: no samples\n", name);
+        return;
+    }
+
+    fprintf(stream, "%s: %lu samples, min %.3f avg %.3f p50 %.3f p90 %.3f p99 %.3f p99.9 %.3f max %.3f\n",
+            name, histogram->count,
+            histogram->min / scale,
+            (double)histogram->sum / histogram->count / scale,
+            histogram_quantile(histogram, 500) / scale,
+            histogram_quantile(histogram, 900) / scale,
+            histogram_quantile(histogram, 990) / scale,
+            histogram_quantile(histogram, 999) / scale,
+            histogram->max / scale);
+}
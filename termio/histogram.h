@@ -0,0 +1,53 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdio.h>
+
+
+/**
+ * Log-linear histogram in the spirit of HdrHistogram: every power of two
+ * is split into HISTOGRAM_SUB linear buckets, which bounds the relative
+ * error of any reported value to 1/HISTOGRAM_SUB while covering the full
+ * 32-bit range in a fixed amount of memory. Recording is a handful of
+ * integer operations, no allocation and no floating point.
+ */
+
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_SUB (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((33 - HISTOGRAM_SUB_BITS) * HISTOGRAM_SUB)
+
+
+struct histogram {
+    unsigned long count;
+    unsigned long long sum;
+    unsigned long min;
+    unsigned long max;
+    unsigned int buckets[HISTOGRAM_BUCKETS];
+};
+
+
+/**
+ * Initializes an empty histogram.
+ */
+void histogram_init(struct histogram * histogram);
+
+/**
+ * Records a value, values above 2^32 - 1 are saturated.
+ */
+void histogram_record(struct histogram * histogram, unsigned long value);
+
+/**
+ * Returns the value below which permille thousandths of the recorded
+ * values fall, e.g. 990 for the 99th percentile. The upper bound of the
+ * bucket is returned, so the result never underestimates.
+ */
+unsigned long histogram_quantile(struct histogram * histogram, unsigned int permille);
+
+/**
+ * Prints a one line summary (count, min, average, p50, p90, p99, p99.9,
+ * max), values being divided by scale (e.g. 1000 to print microseconds
+ * as milliseconds).
+ */
+void histogram_print(FILE * stream, struct histogram * histogram, const char * name, double scale);
+
+#endif
@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "journal.h"
+
+
+static long long clock_us(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+static void segment_name(struct journal * journal, unsigned int segment, char * name, size_t size)
+{
+    snprintf(name, size, "%s.%06u", journal->path, segment);
+}
+
+
+/**
+ * FNV-1a over the 32-bit words of the record, its check field zeroed,
+ * folded to 16 bits.
+ */
+static uint16_t checksum(const struct journal_record * record)
+{
+    struct journal_record copy = *record;
+    uint32_t words[sizeof(copy) / 4];
+    uint32_t hash = 2166136261U;
+    unsigned int i;
+
+    copy.check = 0;
+    memcpy(words, &copy, sizeof(copy));
+    for (i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+        hash = (hash ^ words[i]) * 16777619U;
+    }
+    return hash ^ (hash >> 16);
+}
+
+
+static int valid(const struct journal_record * record, uint64_t index)
+{
+    return record->sequence == (uint32_t)(index + 1) && record->check == checksum(record);
+}
+
+
+static int check_header(struct journal * journal, size_t size)
+{
+    struct journal_header * header = journal->header;
+
+    if (memcmp(header->magic, JOURNAL_MAGIC, sizeof(header->magic)) != 0
+            || header->version != JOURNAL_VERSION
+            || header->record_size != sizeof(struct journal_record)
+            || header->capacity > (size - sizeof(*header)) / sizeof(struct journal_record)
+            || header->committed > header->capacity) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * Maps a segment, creating and preallocating it if it does not exist yet.
+ * An existing one is resumed after its last valid record.
+ */
+static int open_segment(struct journal * journal, unsigned int segment)
+{
+    struct journal_header * header;
+    char name[PATH_MAX];
+    struct stat st;
+    size_t size;
+    void * map;
+    int created;
+    int ret;
+    int fd;
+
+    segment_name(journal, segment, name, sizeof(name));
+    fd = open(name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0) {
+        goto error;
+    }
+
+    // Allocate every block now: running out of space must not turn into
+    // a SIGBUS when a page of the mapping gets written
+    size = st.st_size == 0 ? journal->segment_size : (size_t)st.st_size;
+    if (st.st_size == 0 && (ret = posix_fallocate(fd, 0, size)) != 0) {
+        errno = ret;
+        goto error;
+    }
+    if (size < sizeof(*header) + sizeof(struct journal_record)) {
+        errno = EINVAL;
+        goto error;
+    }
+
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        goto error;
+    }
+    journal->fd = fd;
+    journal->segment = segment;
+    journal->mapped = size;
+    journal->header = header = map;
+    journal->records = (struct journal_record *)(header + 1);
+
+    // Which includes a crash between the allocation and the header
+    created = (header->magic[0] == '\0');
+    if (created) {
+        memcpy(header->magic, JOURNAL_MAGIC, sizeof(header->magic));
+        header->version = JOURNAL_VERSION;
+        header->record_size = sizeof(struct journal_record);
+        header->segment = segment;
+        header->capacity = (size - sizeof(*header)) / sizeof(struct journal_record);
+        header->created = clock_us(CLOCK_REALTIME);
+        header->created_monotonic = clock_us(CLOCK_MONOTONIC);
+        journal->count = 0;
+    } else {
+        if (check_header(journal, size) < 0) {
+            ret = errno;
+            munmap(map, size);
+            errno = ret;
+            goto error;
+        }
+        // Even the committed records: the header may have reached the
+        // disk before them if the last sync was not a waiting one
+        journal->count = 0;
+        while (journal->count < header->capacity
+                && valid(&journal->records[journal->count], journal->count)) {
+            journal->count++;
+        }
+        if (journal->count > header->committed) {
+            journal->recovered += journal->count - header->committed;
+        }
+    }
+    header->flags &= ~JOURNAL_CLOSED;
+
+    return 0;
+
+error:
+    ret = errno;
+    close(fd);
+    errno = ret;
+    return -1;
+}
+
+
+/**
+ * Leaves the current segment for good. Only marked as closed if flags is
+ * MS_SYNC, journal_sync() having been called first.
+ */
+static int close_segment(struct journal * journal, int flags)
+{
+    int ret = 0;
+
+    if (flags == MS_SYNC) {
+        journal->header->flags |= JOURNAL_CLOSED;
+    }
+    if (msync(journal->header, journal->mapped, flags) < 0) {
+        ret = -1;
+    }
+    munmap(journal->header, journal->mapped);
+    close(journal->fd);
+    journal->header = NULL;
+    return ret;
+}
+
+
+int journal_open(struct journal * journal, const char * path, size_t segment_size, long sync_period)
+{
+    char name[PATH_MAX];
+    unsigned int segment = 0;
+
+    memset(journal, 0, sizeof(*journal));
+    journal->path = path;
+    journal->segment_size = segment_size;
+    journal->sync_period = sync_period * 1000LL;
+    journal->synced = clock_us(CLOCK_MONOTONIC);
+
+    // Resume the last segment there is
+    while (1) {
+        segment_name(journal, segment + 1, name, sizeof(name));
+        if (access(name, F_OK) < 0) {
+            break;
+        }
+        segment++;
+    }
+    return open_segment(journal, segment);
+}
+
+
+int journal_append(struct journal * journal, struct journal_record * record)
+{
+    long long elapsed;
+
+    if (journal->count == journal->header->capacity) {
+        if (close_segment(journal, MS_ASYNC) < 0 || open_segment(journal, journal->segment + 1) < 0) {
+            return -1;
+        }
+    }
+
+    record->sequence = journal->count + 1;
+    record->check = checksum(record);
+    memcpy(&journal->records[journal->count], record, sizeof(*record));
+    journal->count++;
+    journal->appended++;
+
+    // The clock of the records tells when to sync, no need to read it
+    elapsed = record->time - journal->synced;
+    if (elapsed >= journal->sync_period || elapsed < 0) {
+        // Only starts the writeback, committed stays where the last
+        // waiting sync left it
+        journal->synced = record->time;
+        journal->syncs++;
+        if (msync(journal->header, sizeof(*journal->header)
+                    + journal->count * sizeof(*record), MS_ASYNC) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+int journal_sync(struct journal * journal)
+{
+    size_t used = sizeof(*journal->header) + journal->count * sizeof(struct journal_record);
+
+    // Records first, then the header which vouches for them
+    if (msync(journal->header, used, MS_SYNC) < 0) {
+        return -1;
+    }
+    journal->header->committed = journal->count;
+    journal->syncs++;
+    return msync(journal->header, sizeof(*journal->header), MS_SYNC);
+}
+
+
+int journal_close(struct journal * journal)
+{
+    if (journal->header == NULL) {
+        return 0;
+    }
+    if (journal_sync(journal) < 0) {
+        return -1;
+    }
+    return close_segment(journal, MS_SYNC);
+}
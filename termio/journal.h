@@ -0,0 +1,117 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * Append-only binary log of fixed-size records, kept in preallocated
+ * segment files mapped in memory. Appending is a copy into the mapping:
+ * the page cache takes it from there, an msync() is only issued every
+ * sync period (measured on the record timestamps) and when a segment is
+ * full and the next one, PATH.000001 after PATH.000000 and so on, is
+ * started.
+ *
+ * Periodic syncs do not wait for the disk (MS_ASYNC guarantees nothing,
+ * on Linux it barely starts the writeback), so nothing is trusted on
+ * reopening: the records are checked from the first one on, their
+ * sequence number and checksum must hold, and the first torn or missing
+ * one ends the segment. The count in the header is only raised by the
+ * syncs which waited for the disk; the records found past it are the
+ * ones recovered.
+ */
+
+#define JOURNAL_MAGIC "TIOJRNL"
+#define JOURNAL_VERSION 1
+
+// Default segment size and sync period (ms)
+#define JOURNAL_SEGMENT (16 << 20)
+#define JOURNAL_SYNC 1000
+
+// Header flags
+#define JOURNAL_CLOSED 1        // Closed cleanly and synced, committed is exact
+
+
+enum journal_status {
+    JOURNAL_SAMPLE = 1,
+    JOURNAL_MALFORMED,          // Frame rejected by the parser
+    JOURNAL_TOO_LONG,           // Frame exceeding the buffer
+};
+
+/**
+ * A record, 32 bytes without padding. Rejected frames only carry the
+ * timestamp and the status.
+ */
+struct journal_record {
+    int64_t time;               // CLOCK_MONOTONIC (us)
+    int64_t value;              // Fixed-point mantissa...
+    uint32_t sensor;
+    uint32_t measure;
+    int8_t scale;               // ...and its number of decimals
+    uint8_t status;             // enum journal_status
+    uint16_t check;             // Checksum of the rest, set by journal_append()
+    uint32_t sequence;          // Index in the segment + 1, set by journal_append()
+};
+
+/**
+ * Header at the beginning of every segment, 64 bytes.
+ */
+struct journal_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t segment;           // Number of the segment
+    uint32_t flags;
+    uint64_t capacity;          // Records the segment holds
+    uint64_t committed;         // Records known to be on disk, after an MS_SYNC
+    int64_t created;            // CLOCK_REALTIME at creation (us)...
+    int64_t created_monotonic;  // ...and CLOCK_MONOTONIC, to date the records
+    uint64_t reserved;
+};
+
+struct journal {
+    const char * path;
+    size_t segment_size;
+    long long sync_period;      // us
+    int fd;
+    unsigned int segment;
+    size_t mapped;              // Size of the current segment
+    struct journal_header * header;
+    struct journal_record * records;
+    uint64_t count;             // Records in the current segment
+    long long synced;           // Timestamp of the record which triggered the last periodic sync
+
+    unsigned long long appended;
+    unsigned long recovered;    // Records found past the committed count
+    unsigned long syncs;
+};
+
+
+/**
+ * Opens the journal at path, resuming its last segment (recovering what
+ * was appended since its last sync) or creating PATH.000000. Segments are
+ * segment_size bytes long, sync_period is in ms. Returns -1 with errno set
+ * on failure.
+ */
+int journal_open(struct journal * journal, const char * path, size_t segment_size, long sync_period);
+
+/**
+ * Appends a record, filling its check and sequence fields. Returns -1 with
+ * errno set if a sync or a new segment failed.
+ */
+int journal_append(struct journal * journal, struct journal_record * record);
+
+/**
+ * Writes the records appended so far to disk and waits for it. Returns -1
+ * with errno set on failure.
+ */
+int journal_sync(struct journal * journal);
+
+/**
+ * Syncs, marks the segment as cleanly closed and unmaps it. Returns -1
+ * with errno set on failure.
+ */
+int journal_close(struct journal * journal);
+
+#endif
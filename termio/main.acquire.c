@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "acquire.h"
+
+
+// Period of the measurement mode reports (s)
+#define REPORT_PERIOD 1
+
+
+static int stop = 0;
+static int restart = 0;
+
+
+void cleanup()
+{
+    if (stop == 0) {
+        printf("Caught SIGINT...\n");
+        stop = 1;
+    }
+}
+
+
+void restart_read()
+{
+    printf("Interrupting read!\n");
+    restart = 1;
+}
+
+
+void usage(const char * name)
+{
+    int i;
+
+    printf("Usage: %s [-s STRATEGY] [-p PROFILE] [-b BAUD] [-f FRAME] [-t TIMEOUT] [-l] [-m] [-T SLOTS]\n", name);
+    printf("          [-o FORMAT] [-B BYTES] [-D DELAY] [-j PATH] [-J BYTES] [-M BYTES] [-S PATH] DEVICE-PATH\n");
+    printf("  -s  How to read the line (default %s):\n", strategies[0]->name);
+    for (i = 0; strategies[i] != NULL; i++) {
+        printf("        %-8s %s\n", strategies[i]->name, strategies[i]->description);
+    }
+    printf("  -p  Line settings (default %s):\n", profiles[0].name);
+    for (i = 0; profiles[i].name != NULL; i++) {
+        printf("        %-8s %s\n", profiles[i].name, profiles[i].description);
+    }
+    printf("  -b  Baud rate, overriding the one of the profile\n");
+    printf("  -f  Shortest expected frame in bytes, sizes VMIN in raw mode (default %d)\n", FRAME_LENGTH);
+    printf("  -t  Response timeout in ms, 0 for none (default %d)\n", TIMEOUT);
+    printf("  -l  Only listen to a sensor sending on its own, no \"get\"\n");
+    printf("  -m  Measurement mode: do not print the samples, report reads per frame\n");
+    printf("      and bytes per wakeup every %ds instead\n", REPORT_PERIOD);
+    printf("  -T  Parse and print on a worker thread, fed through a ring of SLOTS\n");
+    printf("      frames (a power of two), so that a slow output never delays the line\n");
+    printf("  -o  Output format: human, csv, json or binary (default human). With anything\n");
+    printf("      but human, stdout only carries the samples, messages go to stderr\n");
+    printf("  -B  Write the output once BYTES are pending (default %d)...\n", SINK_THRESHOLD);
+    printf("  -D  ...or once the oldest sample pending is DELAY ms old (default %d)\n", SINK_DELAY);
+    printf("  -j  Also append every frame to a binary journal, in PATH.000000 and on\n");
+    printf("  -J  Size of the journal segments in bytes (default %d)\n", JOURNAL_SEGMENT);
+    printf("  -M  Keep the recent samples in memory, in up to BYTES (%d is a good start)\n", STORE_BUDGET);
+    printf("  -S  Keep running statistics of every sensor, saved to PATH every %llds and on\n",
+            STATS_PERIOD / 1000000);
+    printf("      exit, which the statsmerge tool combines with those of other lines\n");
+    printf("  SIGUSR1 abandons the pending request\n");
+    exit(EXIT_FAILURE);
+}
+
+
+int main(int argc, char ** argv)
+{
+    const struct profile * profile;
+    struct line_config config;
+    struct line line;
+    struct sigaction sa;
+    enum read_status status;
+    speed_t speed;
+    ssize_t size;
+    time_t report = 0;
+    char note[80];
+    long baud = 0;
+    int listen = 0;
+    int format = SINK_HUMAN;
+    int chatty;
+    int count;
+    int opt;
+
+    config.strategy = strategies[0];
+    config.profile = profiles[0];
+    config.frame = FRAME_LENGTH;
+    config.timeout = TIMEOUT;
+    config.quiet = 0;
+    config.ring = 0;
+    config.output = STDOUT_FILENO;
+    config.flush_size = SINK_THRESHOLD;
+    config.flush_delay = SINK_DELAY;
+    config.journal = NULL;
+    config.journal_size = JOURNAL_SEGMENT;
+    config.store = 0;
+    config.stats = NULL;
+
+    while ((opt = getopt(argc, argv, "s:p:b:f:t:lmT:o:B:D:j:J:M:S:")) != -1) {
+        switch (opt) {
+            case 's':
+                config.strategy = strategy_find(optarg);
+                if (config.strategy == NULL) {
+                    usage(argv[0]);
+                }
+                break;
+            case 'p':
+                profile = profile_find(optarg);
+                if (profile == NULL) {
+                    usage(argv[0]);
+                }
+                config.profile = *profile;
+                break;
+            case 'b': baud = atol(optarg); break;
+            case 'f': config.frame = atoi(optarg); break;
+            case 't': config.timeout = atoi(optarg); break;
+            case 'l': listen = 1; break;
+            case 'm': config.quiet = 1; break;
+            case 'T': config.ring = atoi(optarg); break;
+            case 'o': format = sink_format_find(optarg); break;
+            case 'B': config.flush_size = atol(optarg); break;
+            case 'D': config.flush_delay = atoi(optarg); break;
+            case 'j': config.journal = optarg; break;
+            case 'J': config.journal_size = atol(optarg); break;
+            case 'M': config.store = atol(optarg); break;
+            case 'S': config.stats = optarg; break;
+            default: usage(argv[0]);
+        }
+    }
+
+    if (baud != 0) {
+        config.profile.baud = baud;
+    }
+
+    if (optind != argc - 1 || config.timeout < 0 || config.frame < 1 || config.frame >= BUFSIZE
+            || (config.ring & (config.ring - 1)) != 0 || format < 0 || config.flush_delay < 0
+            || baud_to_speed(config.profile.baud, &speed) < 0) {
+        usage(argv[0]);
+    }
+
+    // A listening line has no request to time out
+    if (listen) {
+        config.timeout = 0;
+    }
+
+    // Only the samples go to the original stdout, whatever else is printed
+    // ends up on stderr
+    config.format = format;
+    if (format != SINK_HUMAN) {
+        config.output = dup(STDOUT_FILENO);
+        CHECKERR(config.output, "Failed to duplicate stdout (fd=%d)", STDOUT_FILENO);
+        CHECKERR(dup2(STDERR_FILENO, STDOUT_FILENO), "Failed to redirect stdout (fd=%d)", STDERR_FILENO);
+    }
+    // The samples bypass stdio, keep the rest of stdout in order with them
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    // With a worker thread, stdout is its business only: the reader must
+    // not block on it, and only prints what ends the loop
+    chatty = !config.quiet && config.ring == 0;
+    line_open(&line, argv[optind], &config);
+
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sa.sa_handler = cleanup;
+    sigaction(SIGINT, &sa, NULL);
+
+    sa.sa_handler = restart_read;
+    sigaction(SIGUSR1, &sa, NULL);
+
+    printf("Waiting for data...\n");
+
+    while (stop == 0) {
+        if (!listen) {
+            size = line_request(&line);
+            if (stop == 0) {
+                CHECKERR(size, "Failed to write data to %s", line.path);
+            } else {
+                printf("Write interrupted, exiting main loop...\n");
+                break;
+            }
+#ifdef DEBUG
+            if (chatty) {
+                printf(" > %zd bytes written\n", size);
+            }
+#endif
+        }
+
+        while (stop == 0) {
+            status = line_read(&line);
+            if (stop != 0) {
+                printf("Read interrupted, exiting main loop...\n");
+                break;
+            } else if (status == READ_TIMEOUT) {
+                if (chatty) {
+                    snprintf(note, sizeof(note), " - Read operation timed out (%dms), restarting read loop...\n",
+                            config.timeout);
+                    line_note(&line, note);
+                }
+                break;
+            } else if (status == READ_INTERRUPTED) {
+                if (restart) {
+                    restart = 0;
+                    printf("Continuing\n");
+                    break;
+                }
+                continue;
+            }
+
+            // A single read may carry several frames, the beginning of
+            // the next one stays buffered until it is complete
+            count = line_process(&line);
+
+            if (config.quiet && time(NULL) >= report + REPORT_PERIOD) {
+                report = time(NULL);
+                line_print_io(&line);
+            }
+            if (count > 0 && !listen) {
+                break;
+            }
+        }
+    }
+
+    printf("Main loop done, cleaning up...\n");
+    line_close(&line);
+    line_print_stats(&line);
+    line_print_io(&line);
+
+    return EXIT_SUCCESS;
+}
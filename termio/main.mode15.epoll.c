@@ -0,0 +1,561 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <string.h>
+#include <unistd.h>
+#include <termios.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+
+#include "parser.h"
+#include "framer.h"
+#include "wheel.h"
+#include "rtt.h"
+#include "histogram.h"
+
+
+#define CHECKERR(val, fmt, ...) {               \
+    if ((val) < 0) {                            \
+        fprintf(stderr, fmt": ", __VA_ARGS__);  \
+        perror(NULL);                           \
+        exit(EXIT_FAILURE);                     \
+    }                                           \
+}
+
+#define BUFSIZE 51
+
+// Default response timeout, and bounds of the adaptive one
+#define TIMEOUT 620
+#define MIN_TIMEOUT 1
+#define MAX_TIMEOUT 60000
+
+#define MAX_DEVICES 256
+#define MAX_EVENTS 64
+#define MAX_WINDOW 32
+
+
+struct device;
+
+/**
+ * State of a single serial line. Every device runs its own "get"/response
+ * cycle, independently of the others.
+ */
+enum device_state {
+    DEV_ACTIVE,
+    DEV_CLOSED,         // Removed from the loop after an error or a hangup
+};
+
+/**
+ * An outstanding "get". Responses are matched to requests in the order
+ * the requests were sent.
+ */
+struct request {
+    struct timer timer;         // Response deadline
+    struct device * dev;
+    long long sent;             // In us
+    long timeout;               // In us
+    long long answered;         // First byte of the response received (us), 0 before
+    int shadowed;               // A frame was taken for a late answer while it was the oldest
+};
+
+/**
+ * Always-on per-device instrumentation, dumped on SIGUSR1 and on exit.
+ * Latencies are in us.
+ */
+struct device_stats {
+    struct histogram first_byte;        // "get" written to first byte read
+    struct histogram complete;          // "get" written to frame complete
+    unsigned long samples;
+    unsigned long timeouts;
+    unsigned long too_long;
+    unsigned long malformed;
+    unsigned long late;
+    unsigned long ambiguous;            // Late answers which may have been the oldest request's
+};
+
+struct device {
+    char * path;
+    int fd;
+    enum device_state state;
+    struct termios saved_conf;
+    int conf_was_saved;
+
+    struct framer framer;
+    struct request inflight[MAX_WINDOW];    // FIFO of outstanding requests
+    int first;
+    int pending;
+    long long deadline;         // Of the newest request (ms), never decreasing
+    int expired;                // Timed out requests whose late answer may still come
+    struct rtt rtt;
+    struct device_stats stats;
+};
+
+
+static struct device devices[MAX_DEVICES];
+static int device_count = 0;
+static int alive_count = 0;
+static int window = 1;
+static int adaptive = 0;
+static int min_timeout = TIMEOUT;
+static int max_timeout = TIMEOUT;
+static int epfd = -1;
+static struct wheel wheel;
+static int stop = 0;
+static volatile sig_atomic_t dump = 0;
+
+
+long long now_us()
+{
+    struct timespec ts;
+
+    CHECKERR(clock_gettime(CLOCK_MONOTONIC, &ts), "Couldn't read clock (%d)", CLOCK_MONOTONIC);
+
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+long long now_ms()
+{
+    return now_us() / 1000;
+}
+
+
+void configure(struct device * dev)
+{
+    struct termios conf;
+    int fd = dev->fd;
+
+    printf("Configuring '%s' through termios...\n", dev->path);
+
+    // Zero out the struct
+    memset(&conf, 0, sizeof(conf));
+
+    // Configure flags
+    conf.c_iflag = IGNCR;
+    conf.c_oflag = 0;
+    conf.c_cflag = CS8 | CREAD;
+    conf.c_lflag = ICANON;
+
+    // Set speed
+    CHECKERR(cfsetispeed(&conf, B9600), "Couldn't set in speed (fd=%d)", fd);
+    CHECKERR(cfsetospeed(&conf, B9600), "Couldn't set out speed (fd=%d)", fd);
+
+    // Save previous termios config and apply the new one
+    CHECKERR(tcgetattr(fd, &dev->saved_conf), "Couldn't save termios (fd=%d)", fd);
+    dev->conf_was_saved = 1;
+    CHECKERR(tcsetattr(fd, TCSAFLUSH, &conf), "Couldn't set termios (fd=%d)", fd);
+}
+
+
+void open_and_setup(struct device * dev)
+{
+    printf("Opening device at '%s'...\n", dev->path);
+    dev->fd = open(dev->path, O_RDWR | O_NONBLOCK);
+    CHECKERR(dev->fd, "Failed to open device %s", dev->path);
+
+    configure(dev);
+}
+
+
+void close_and_restore(struct device * dev)
+{
+    if (dev->conf_was_saved) {
+        CHECKERR(tcsetattr(dev->fd, TCSAFLUSH, &dev->saved_conf), "Couldn't reset termios for fd=%d", dev->fd);
+    }
+    close(dev->fd);
+}
+
+
+void repr(char * str)
+{
+    printf("\"");
+    while (*str) {
+        switch (*str) {
+            case 9: printf("\\t"); break;
+            case 10: printf("\\n"); break;
+            case 13: printf("\\r"); break;
+            default:
+                if (*str < 32) {
+                    printf("\\x%2d", *str);
+                } else {
+                    printf("%c", *str);
+                }
+        }
+        str++;
+    }
+    printf("\"\n");
+}
+
+
+void cleanup()
+{
+    if (stop == 0) {
+        printf("Caught SIGINT...\n");
+        stop = 1;
+    }
+}
+
+
+void request_dump()
+{
+    dump = 1;
+}
+
+
+void dump_stats()
+{
+    struct device_stats * stats;
+    int i;
+
+    for (i = 0; i < device_count; i++) {
+        stats = &devices[i].stats;
+        printf("[%s] %lu samples, %lu timeouts, %lu too long, %lu malformed, %lu late (%lu ambiguous)\n",
+                devices[i].path, stats->samples, stats->timeouts, stats->too_long,
+                stats->malformed, stats->late, stats->ambiguous);
+        histogram_print(stdout, &stats->first_byte, "  first byte (ms)", 1000.0);
+        histogram_print(stdout, &stats->complete, "  complete frame (ms)", 1000.0);
+    }
+    fflush(stdout);
+}
+
+
+/**
+ * Retires the oldest outstanding request, returns 0 if there was none.
+ */
+int complete_request(struct device * dev)
+{
+    if (dev->pending == 0) {
+        return 0;
+    }
+    wheel_cancel(&wheel, &dev->inflight[dev->first].timer);
+    dev->first = (dev->first + 1) % MAX_WINDOW;
+    dev->pending--;
+    return 1;
+}
+
+
+/**
+ * Removes a device from the loop, it will not be polled anymore.
+ */
+void drop_device(struct device * dev)
+{
+    printf("[%s] Device lost, removing it from the loop...\n", dev->path);
+    epoll_ctl(epfd, EPOLL_CTL_DEL, dev->fd, NULL);
+    close(dev->fd);
+
+    while (complete_request(dev)) {
+        // Cancel the timers of all outstanding requests
+    }
+
+    dev->state = DEV_CLOSED;
+    alive_count--;
+}
+
+
+/**
+ * Sends "get" requests until the device has a full window of outstanding
+ * ones, each with its own response timeout.
+ */
+void send_requests(struct device * dev)
+{
+    struct request * req;
+    long long deadline;
+    ssize_t size;
+
+    while (dev->state != DEV_CLOSED && dev->pending < window) {
+        size = write(dev->fd, "get", 3);
+        if (size < 0 && errno != EAGAIN && errno != EINTR) {
+            fprintf(stderr, "[%s] Failed to write data: ", dev->path);
+            perror(NULL);
+            drop_device(dev);
+            return;
+        }
+#ifdef DEBUG
+        printf("[%s] > %zd bytes written\n", dev->path, size);
+#endif
+
+        // A failed write is handled as a lost request: the timeout will
+        // free its slot.
+        req = &dev->inflight[(dev->first + dev->pending) % MAX_WINDOW];
+        req->sent = now_us();
+        req->timeout = dev->rtt.timeout;
+        req->answered = 0;
+        req->shadowed = 0;
+        // The timeout may have shrunk since the previous request was sent,
+        // which must not expire after this one
+        deadline = (req->sent + req->timeout + 999) / 1000;
+        if (deadline < dev->deadline) {
+            deadline = dev->deadline;
+        }
+        dev->deadline = deadline;
+        wheel_arm(&wheel, &req->timer, deadline);
+        dev->pending++;
+    }
+}
+
+
+void process(struct device * dev, char * frame, size_t len)
+{
+    struct sample sample;
+    enum parse_status status;
+    char value[48];
+
+    status = parse_frame(frame, len, &sample);
+    if (status != PARSE_OK) {
+        dev->stats.malformed++;
+        printf("[%s] - Received data has wrong format (%s). Received string (%zu bytes) is: ", dev->path, parse_strerror(status), len);
+        repr(frame);
+    } else {
+        dev->stats.samples++;
+        *format_fixed(value, sample.value, 3, 8) = '\0';
+        printf("[%s] + New value received from sensor: %u %u %s\n", dev->path, sample.sensor, sample.measure, value);
+    }
+}
+
+
+/**
+ * Drains everything the device has to offer and advances its state
+ * machine. Called when epoll reports the fd as readable.
+ */
+void handle_input(struct device * dev)
+{
+    char frame[BUFSIZE];
+    struct iovec iov[2];
+    struct request * req;
+    enum frame_status status;
+    long long now;
+    ssize_t size;
+    size_t len;
+    int count;
+
+    while (dev->state != DEV_CLOSED) {
+        count = framer_iov(&dev->framer, iov);
+        size = readv(dev->fd, iov, count);
+        if (size < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return;
+        } else if (size <= 0) {
+            if (size < 0) {
+                fprintf(stderr, "[%s] Failed to read data: ", dev->path);
+                perror(NULL);
+            }
+            drop_device(dev);
+            return;
+        }
+
+        framer_commit(&dev->framer, size);
+        now = now_us();
+
+        // Bytes belong to the oldest outstanding request, unless they turn
+        // out to be a late answer: they are only accounted for with the
+        // frame
+        req = &dev->inflight[dev->first];
+        if (dev->pending > 0 && req->answered == 0) {
+            req->answered = now;
+        }
+
+        while ((status = framer_next(&dev->framer, frame, sizeof(frame), &len)) != FRAME_NONE) {
+            req = &dev->inflight[dev->first];
+            if (dev->expired > 0 && dev->pending > 0) {
+                // The device answers in order, so this is taken for the late
+                // answer of a request which timed out, and the oldest one
+                // stays in flight. Without request ids it may as well be its
+                // answer, the other one having been lost: the oldest then
+                // times out without leaving a late answer to expect, and the
+                // matching realigns. Karn's rule: its delay tells nothing
+                // either, and the timeout stays backed off until a clean
+                // sample comes.
+                dev->expired--;
+                dev->stats.late++;
+                dev->stats.ambiguous++;
+                req->answered = 0;
+                req->shadowed = 1;
+                printf("[%s] - Received a late response\n", dev->path);
+            } else if (dev->pending > 0) {
+                rtt_sample(&dev->rtt, now - req->sent);
+                // Several frames in one read, this is the first byte too
+                histogram_record(&dev->stats.first_byte, (req->answered != 0 ? req->answered : now) - req->sent);
+                histogram_record(&dev->stats.complete, now - req->sent);
+                complete_request(dev);
+            } else {
+                // Answer to a request which already timed out
+                if (dev->expired > 0) {
+                    dev->expired--;
+                }
+                dev->stats.late++;
+                printf("[%s] - Received a late response\n", dev->path);
+            }
+            if (status == FRAME_TOO_LONG) {
+                dev->stats.too_long++;
+                printf("[%s] - Received data is too long (%zu), skipping it...\n", dev->path, len);
+            } else {
+                // We found a line feed (CRs are ignored by termios)
+                process(dev, frame, len);
+            }
+        }
+
+        send_requests(dev);
+    }
+}
+
+
+/**
+ * Deadline of a request reached. The deadlines of a device never decrease
+ * along its window, but those falling on the same tick expire in no
+ * particular order: the requests sent before the expired one are overdue
+ * as well. Free their window slots and send new ones.
+ */
+void request_expired(struct timer * timer)
+{
+    struct request * req = (struct request *)timer;
+    struct device * dev = req->dev;
+    struct request * head;
+
+    do {
+        head = &dev->inflight[dev->first];
+        printf("[%s] - Read operation timed out (%ldms), restarting read loop...\n", dev->path, head->timeout / 1000);
+        rtt_backoff(&dev->rtt);
+        dev->stats.timeouts++;
+        // A device answers in order, no more late answers can be queued
+        // than requests were in flight. One may already have been taken
+        // for a late answer while this request was the oldest.
+        if (!head->shadowed && dev->expired < window) {
+            dev->expired++;
+        }
+        complete_request(dev);
+    } while (head != req && dev->pending > 0);
+    send_requests(dev);
+}
+
+
+int main(int argc, char ** argv)
+{
+    struct epoll_event events[MAX_EVENTS];
+    struct epoll_event ev;
+    struct sigaction sa;
+    long long now;
+    long long next;
+    int timeout;
+    int count;
+    int opt;
+    int i, j;
+
+    while ((opt = getopt(argc, argv, "w:a:")) != -1) {
+        switch (opt) {
+            case 'w':
+                window = atoi(optarg);
+                break;
+            case 'a':
+                adaptive = 1;
+                if (sscanf(optarg, "%d:%d", &min_timeout, &max_timeout) != 2) {
+                    min_timeout = 0;
+                }
+                break;
+            default:
+                window = 0;
+        }
+    }
+
+    if (optind == argc || argc - optind > MAX_DEVICES || window < 1 || window > MAX_WINDOW
+            || min_timeout < MIN_TIMEOUT || max_timeout > MAX_TIMEOUT || min_timeout > max_timeout) {
+        printf("Usage: %s [-w WINDOW] [-a FLOOR:CEILING] DEVICE-PATH [DEVICE-PATH...]\n", argv[0]);
+        printf("  Up to %d devices, each with up to WINDOW (1-%d, default 1) requests in flight\n", MAX_DEVICES, MAX_WINDOW);
+        printf("  -a derives the timeout of each device from its round-trip time, within\n");
+        printf("     [FLOOR, CEILING] ms (%d-%d), instead of the fixed %dms\n", MIN_TIMEOUT, MAX_TIMEOUT, TIMEOUT);
+        exit(EXIT_FAILURE);
+    }
+
+    wheel_init(&wheel, now_ms());
+
+    epfd = epoll_create(MAX_DEVICES);
+    CHECKERR(epfd, "Failed to create epoll instance (%d devices)", argc - optind);
+
+    for (i = optind; i < argc; i++) {
+        struct device * dev = &devices[device_count++];
+        alive_count++;
+
+        memset(dev, 0, sizeof(*dev));
+        dev->path = argv[i];
+        framer_init(&dev->framer, BUFSIZE - 1);
+        rtt_init(&dev->rtt, TIMEOUT * 1000L, min_timeout * 1000L, max_timeout * 1000L);
+        histogram_init(&dev->stats.first_byte);
+        histogram_init(&dev->stats.complete);
+        for (j = 0; j < MAX_WINDOW; j++) {
+            timer_init(&dev->inflight[j].timer, request_expired);
+            dev->inflight[j].dev = dev;
+        }
+        open_and_setup(dev);
+
+        ev.events = EPOLLIN;
+        ev.data.ptr = dev;
+        CHECKERR(epoll_ctl(epfd, EPOLL_CTL_ADD, dev->fd, &ev), "Failed to watch device %s", dev->path);
+    }
+
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sa.sa_handler = cleanup;
+    sigaction(SIGINT, &sa, NULL);
+
+    sa.sa_handler = request_dump;
+    sigaction(SIGUSR1, &sa, NULL);
+
+    printf("Waiting for data from %d devices (window: %d)...\n", device_count, window);
+
+    for (i = 0; i < device_count; i++) {
+        send_requests(&devices[i]);
+    }
+
+    while (stop == 0) {
+        // Whenever SIGUSR1 came, even while events were being handled
+        if (dump) {
+            dump = 0;
+            dump_stats();
+        }
+
+        now = now_ms();
+        wheel_advance(&wheel, now);
+        next = wheel_next(&wheel);
+        timeout = next < 0 ? -1 : (int)(next - now);
+
+        if (alive_count == 0) {
+            printf("No devices left, exiting main loop...\n");
+            break;
+        }
+
+        count = epoll_wait(epfd, events, MAX_EVENTS, timeout);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        CHECKERR(count, "Failed to wait for events (epfd=%d)", epfd);
+
+        for (i = 0; i < count && stop == 0; i++) {
+            struct device * dev = events[i].data.ptr;
+
+            if (events[i].events & EPOLLIN) {
+                handle_input(dev);
+            } else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                drop_device(dev);
+            }
+        }
+    }
+
+    printf("Main loop done, cleaning up...\n");
+    dump_stats();
+    for (i = 0; adaptive && i < device_count; i++) {
+        printf("[%s] Round-trip time %.3fms (+/- %.3fms), timeout %.3fms\n", devices[i].path,
+                devices[i].rtt.srtt / 1000.0, devices[i].rtt.rttvar / 1000.0, devices[i].rtt.timeout / 1000.0);
+    }
+    for (i = 0; i < device_count; i++) {
+        if (devices[i].state != DEV_CLOSED) {
+            close_and_restore(&devices[i]);
+        }
+    }
+    close(epfd);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+#include <stdint.h>
+#include <limits.h>
+
+#include "parser.h"
+
+
+#define PREFIX "StringFromSensor"
+#define PREFIX_LEN (sizeof(PREFIX) - 1)
+
+#define IS_DIGIT(c) ((unsigned char)((c) - '0') <= 9)
+#define IS_SPACE(c) ((c) == ' ' || ((c) >= '\t' && (c) <= '\r'))
+
+// Whether m * 10 + d overflows the mantissa, with constant divisions only:
+// 64-bit ones are library calls on the APF27
+#define MANTISSA_OVERFLOWS(m, d) ((m) > INT64_MAX / 10 || ((m) == INT64_MAX / 10 && (d) > INT64_MAX % 10))
+
+
+/**
+ * Parses an unsigned decimal field starting at *pos and advances *pos past
+ * its last digit.
+ */
+static enum parse_status parse_uint(const char ** pos, const char * end, unsigned int * out)
+{
+    const char * p = *pos;
+    unsigned int value = 0;
+    unsigned int digit;
+
+    if (p == end) {
+        return PARSE_TRUNCATED;
+    }
+    if (!IS_DIGIT(*p)) {
+        return PARSE_BAD_FIELD;
+    }
+
+    do {
+        digit = *p - '0';
+        if (value > (UINT_MAX - digit) / 10) {
+            return PARSE_OVERFLOW;
+        }
+        value = value * 10 + digit;
+        p++;
+    } while (p < end && IS_DIGIT(*p));
+
+    *pos = p;
+    *out = value;
+    return PARSE_OK;
+}
+
+
+/**
+ * Expects the '_' field separator at *pos and skips it.
+ */
+static enum parse_status parse_separator(const char ** pos, const char * end)
+{
+    if (*pos == end) {
+        return PARSE_TRUNCATED;
+    }
+    if (**pos != '_') {
+        return PARSE_BAD_FIELD;
+    }
+    (*pos)++;
+    return PARSE_OK;
+}
+
+
+/**
+ * Parses a [+-]digits[.digits] value. The digits are accumulated into the
+ * mantissa as is, the decimals setting the scale. Decimals which do not fit
+ * the mantissa, or beyond FIXED_MAX_SCALE, are simply skipped.
+ */
+static enum parse_status parse_value(const char ** pos, const char * end, struct fixed * out)
+{
+    const char * p = *pos;
+    uint64_t mantissa = 0;
+    unsigned int digit;
+    int scale = 0;
+    int digits = 0;
+    int negative = 0;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+
+    while (p < end && IS_DIGIT(*p)) {
+        digit = *p - '0';
+        if (MANTISSA_OVERFLOWS(mantissa, digit)) {
+            return PARSE_OVERFLOW;
+        }
+        mantissa = mantissa * 10 + digit;
+        digits++;
+        p++;
+    }
+
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && IS_DIGIT(*p)) {
+            digit = *p - '0';
+            if (scale < FIXED_MAX_SCALE && !MANTISSA_OVERFLOWS(mantissa, digit)) {
+                mantissa = mantissa * 10 + digit;
+                scale++;
+            }
+            digits++;
+            p++;
+        }
+    }
+
+    if (digits == 0) {
+        return p == end ? PARSE_TRUNCATED : PARSE_BAD_FIELD;
+    }
+
+    out->mantissa = negative ? -(int64_t)mantissa : (int64_t)mantissa;
+    out->scale = scale;
+    *pos = p;
+    return PARSE_OK;
+}
+
+
+enum parse_status parse_frame(const char * buf, size_t len, struct sample * sample)
+{
+    const char * p = buf;
+    const char * end = buf + len;
+    struct sample parsed;
+    enum parse_status status;
+    size_t i;
+
+    for (i = 0; i < PREFIX_LEN; i++) {
+        if (i == len) {
+            return PARSE_TRUNCATED;
+        }
+        if (buf[i] != PREFIX[i]) {
+            return PARSE_BAD_PREFIX;
+        }
+    }
+    p += PREFIX_LEN;
+
+    if ((status = parse_uint(&p, end, &parsed.sensor)) != PARSE_OK
+            || (status = parse_separator(&p, end)) != PARSE_OK
+            || (status = parse_uint(&p, end, &parsed.measure)) != PARSE_OK
+            || (status = parse_separator(&p, end)) != PARSE_OK
+            || (status = parse_value(&p, end, &parsed.value)) != PARSE_OK) {
+        return status;
+    }
+
+    while (p < end && IS_SPACE(*p)) {
+        p++;
+    }
+    if (p != end) {
+        return PARSE_TRAILING;
+    }
+
+    *sample = parsed;
+    return PARSE_OK;
+}
+
+
+const char * parse_strerror(enum parse_status status)
+{
+    switch (status) {
+        case PARSE_OK: return "ok";
+        case PARSE_BAD_PREFIX: return "bad prefix";
+        case PARSE_BAD_FIELD: return "bad field";
+        case PARSE_OVERFLOW: return "overflow";
+        case PARSE_TRUNCATED: return "truncated";
+        case PARSE_TRAILING: return "trailing garbage";
+    }
+    return "unknown";
+}
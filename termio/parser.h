@@ -0,0 +1,46 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <stddef.h>
+
+#include "fixed.h"
+
+
+/**
+ * A single measure as sent by the sensor, i.e. the decoded content of a
+ * "StringFromSensor<sensor>_<measure>_<value>\n" frame.
+ */
+struct sample {
+    unsigned int sensor;
+    unsigned int measure;
+    struct fixed value;         // Scaled by the decimals sent
+};
+
+
+/**
+ * Outcome of parse_frame(). Everything but PARSE_OK means the frame was
+ * rejected and the sample left untouched.
+ */
+enum parse_status {
+    PARSE_OK = 0,
+    PARSE_BAD_PREFIX,       // Does not start with "StringFromSensor"
+    PARSE_BAD_FIELD,        // Unexpected character inside a field
+    PARSE_OVERFLOW,         // A numeric field does not fit its type
+    PARSE_TRUNCATED,        // Frame ends before the value is complete
+    PARSE_TRAILING,         // Garbage after the value
+};
+
+
+/**
+ * Parses a frame of len bytes in a single pass, without allocating nor
+ * requiring buf to be NUL-terminated. Trailing whitespace (the newline)
+ * is accepted.
+ */
+enum parse_status parse_frame(const char * buf, size_t len, struct sample * sample);
+
+/**
+ * Returns a short human readable description of a parse status.
+ */
+const char * parse_strerror(enum parse_status status);
+
+#endif
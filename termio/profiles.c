@@ -0,0 +1,72 @@
+#include <string.h>
+#include <termios.h>
+
+#include "acquire.h"
+
+
+const struct profile profiles[] = {
+    { "legacy", "9600 bauds, canonical mode", 9600, 1, 0, 0 },
+    { "batch", "9600 bauds, raw, one read per frame", 9600, 0, 0, 1 },
+    { "fast", "115200 bauds, raw, one read per frame", 115200, 0, 0, 1 },
+    { "max", "4000000 bauds, raw, one read per frame", 4000000, 0, 0, 1 },
+    { NULL, NULL, 0, 0, 0, 0 },
+};
+
+
+static const struct {
+    long baud;
+    speed_t speed;
+} speeds[] = {
+    { 1200, B1200 },
+    { 2400, B2400 },
+    { 4800, B4800 },
+    { 9600, B9600 },
+    { 19200, B19200 },
+    { 38400, B38400 },
+    { 57600, B57600 },
+    { 115200, B115200 },
+    { 230400, B230400 },
+#ifdef B460800
+    { 460800, B460800 },
+    { 500000, B500000 },
+    { 576000, B576000 },
+    { 921600, B921600 },
+    { 1000000, B1000000 },
+    { 1152000, B1152000 },
+    { 1500000, B1500000 },
+    { 2000000, B2000000 },
+#endif
+#ifdef B4000000
+    { 2500000, B2500000 },
+    { 3000000, B3000000 },
+    { 3500000, B3500000 },
+    { 4000000, B4000000 },
+#endif
+};
+
+
+const struct profile * profile_find(const char * name)
+{
+    int i;
+
+    for (i = 0; profiles[i].name != NULL; i++) {
+        if (strcmp(profiles[i].name, name) == 0) {
+            return &profiles[i];
+        }
+    }
+    return NULL;
+}
+
+
+int baud_to_speed(long baud, speed_t * speed)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+        if (speeds[i].baud == baud) {
+            *speed = speeds[i].speed;
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,65 @@
+#include "rtt.h"
+
+
+// Clock granularity, the loop deadlines have a 1ms resolution
+#define GRANULARITY 1000
+
+
+static long clamp(struct rtt * rtt, long timeout)
+{
+    if (timeout < rtt->floor) {
+        return rtt->floor;
+    }
+    if (timeout > rtt->ceiling) {
+        return rtt->ceiling;
+    }
+    return timeout;
+}
+
+
+void rtt_init(struct rtt * rtt, long initial, long floor, long ceiling)
+{
+    rtt->srtt = 0;
+    rtt->rttvar = 0;
+    rtt->floor = floor;
+    rtt->ceiling = ceiling;
+    rtt->measured = 0;
+    rtt->timeout = clamp(rtt, initial);
+}
+
+
+void rtt_sample(struct rtt * rtt, long measured)
+{
+    long delta;
+    long margin;
+
+    if (measured < 0) {
+        measured = 0;
+    }
+
+    if (!rtt->measured) {
+        rtt->srtt = measured;
+        rtt->rttvar = measured / 2;
+        rtt->measured = 1;
+    } else {
+        delta = rtt->srtt - measured;
+        if (delta < 0) {
+            delta = -delta;
+        }
+        // rttvar = 3/4 rttvar + 1/4 |srtt - R|, srtt = 7/8 srtt + 1/8 R
+        rtt->rttvar += (delta - rtt->rttvar) / 4;
+        rtt->srtt += (measured - rtt->srtt) / 8;
+    }
+
+    margin = 4 * rtt->rttvar;
+    if (margin < GRANULARITY) {
+        margin = GRANULARITY;
+    }
+    rtt->timeout = clamp(rtt, rtt->srtt + margin);
+}
+
+
+void rtt_backoff(struct rtt * rtt)
+{
+    rtt->timeout = clamp(rtt, rtt->timeout * 2);
+}
@@ -0,0 +1,39 @@
+#ifndef RTT_H
+#define RTT_H
+
+
+/**
+ * Round-trip time estimator deriving a response timeout from the measured
+ * request/response delays, in the style of the TCP retransmission timer
+ * (RFC 6298). Integer only, all times are in microseconds.
+ */
+struct rtt {
+    long srtt;                  // Smoothed round-trip time
+    long rttvar;                // Round-trip time variation
+    long timeout;
+    long floor;
+    long ceiling;
+    int measured;               // At least one sample was taken
+};
+
+
+/**
+ * Initializes an estimator which starts with the given timeout, until the
+ * first sample is measured. Timeouts are always kept within [floor,
+ * ceiling].
+ */
+void rtt_init(struct rtt * rtt, long initial, long floor, long ceiling);
+
+/**
+ * Feeds a measured round-trip time and updates the timeout.
+ */
+void rtt_sample(struct rtt * rtt, long measured);
+
+/**
+ * Doubles the timeout after a request timed out, so that a dead line is
+ * not flooded with requests. The next sample brings it back, which must
+ * therefore not be one a late answer could have produced (Karn's rule).
+ */
+void rtt_backoff(struct rtt * rtt);
+
+#endif
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+
+/**
+ * Stand-in for a bench of serial sensors: creates pseudo-terminals, prints
+ * the path of their slave side (one per line, to be handed to any of the
+ * acquisition variants) and answers their "get" until interrupted.
+ *
+ * Usage: sensorsim [-n COUNT] [-d DELAY] [-j JITTER] [-l DROP] [-m MALFORMED]
+ *                  [-o OVERSIZE] [-b BURST] [-s RATE] [-t DURATION]
+ */
+
+#define CHECKERR(val, fmt, ...) {               \
+    if ((val) < 0) {                            \
+        fprintf(stderr, fmt": ", __VA_ARGS__);  \
+        perror(NULL);                           \
+        exit(EXIT_FAILURE);                     \
+    }                                           \
+}
+
+#define MAX_DEVICES 1024
+
+
+static volatile int stop = 0;
+
+
+void cleanup()
+{
+    stop = 1;
+}
+
+
+/**
+ * Parses a percentage with up to one decimal into per mille.
+ */
+int permille(const char * arg)
+{
+    return (int)(atof(arg) * 10 + 0.5);
+}
+
+
+void usage(const char * name)
+{
+    printf("Usage: %s [-n COUNT] [-d DELAY] [-j JITTER] [-l DROP] [-m MALFORMED]\n", name);
+    printf("       %*s [-o OVERSIZE] [-b BURST] [-s RATE] [-t DURATION]\n", (int)strlen(name), "");
+    printf("  -n  Devices to simulate (1-%d, default 1)\n", MAX_DEVICES);
+    printf("  -d  Response delay in ms (default 15), -j adds up to JITTER ms\n");
+    printf("  -l  Requests left unanswered, or frames skipped when streaming (%%)\n");
+    printf("  -m  Responses sent malformed (%%)\n");
+    printf("  -o  Responses preceded by an oversize frame (%%)\n");
+    printf("  -b  Responses followed by an extra frame (%%)\n");
+    printf("  -s  Stream RATE frames/s per device (1-1000) instead of answering \"get\"\n");
+    printf("  -t  Stop after DURATION ms instead of on SIGINT\n");
+    exit(EXIT_FAILURE);
+}
+
+
+int main(int argc, char ** argv)
+{
+    struct sim_config config;
+    struct sim sim;
+    struct sigaction sa;
+    long duration = 0;
+    int count = 1;
+    int opt;
+    int i;
+
+    memset(&config, 0, sizeof(config));
+    config.delay = 15;
+
+    while ((opt = getopt(argc, argv, "n:d:j:l:m:o:b:s:t:")) != -1) {
+        switch (opt) {
+            case 'n': count = atoi(optarg); break;
+            case 'd': config.delay = atoi(optarg); break;
+            case 'j': config.jitter = atoi(optarg); break;
+            case 'l': config.drop = permille(optarg); break;
+            case 'm': config.malformed = permille(optarg); break;
+            case 'o': config.oversize = permille(optarg); break;
+            case 'b': config.burst = permille(optarg); break;
+            case 's': config.rate = atoi(optarg); break;
+            case 't': duration = atol(optarg); break;
+            default: usage(argv[0]);
+        }
+    }
+
+    if (optind != argc || count < 1 || count > MAX_DEVICES || config.delay < 0 || config.jitter < 0
+            || config.rate < 0 || config.rate > 1000 || duration < 0) {
+        usage(argv[0]);
+    }
+
+    CHECKERR(sim_init(&sim, &config, count), "Failed to create %d simulated devices", count);
+
+    for (i = 0; i < sim.count; i++) {
+        printf("%s\n", sim.devices[i].path);
+    }
+    fflush(stdout);
+
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sa.sa_handler = cleanup;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    CHECKERR(sim_run(&sim, &stop, duration), "Simulation failed (%d devices)", count);
+
+    fprintf(stderr, "%lu requests, %lu responses, %lu dropped, %lu malformed, %lu oversize, "
+            "%lu burst, %lu overruns\n", sim.stats.requests, sim.stats.responses, sim.stats.dropped,
+            sim.stats.malformed, sim.stats.oversize, sim.stats.burst, sim.stats.overruns);
+
+    sim_close(&sim);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,410 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/epoll.h>
+
+#include "sim.h"
+
+
+#define REQUEST "get"
+#define REQUEST_LEN (sizeof(REQUEST) - 1)
+
+#define OVERSIZE 80
+#define MAX_EVENTS 64
+#define IDLE_TIMEOUT 100
+
+
+static long long now_us()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/**
+ * Xorshift generator, good enough to pick faults and cheap enough not to
+ * weigh on the load generated.
+ */
+static unsigned int next_random(struct sim * sim)
+{
+    unsigned int x = sim->seed;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sim->seed = x;
+    return x;
+}
+
+
+static int chance(struct sim * sim, int permille)
+{
+    return permille > 0 && (int)(next_random(sim) % 1000) < permille;
+}
+
+
+/**
+ * Formats the next measure of the device into buf, corrupted if asked to.
+ * Returns the length of the frame.
+ */
+static int format_frame(struct sim_device * dev, char * buf, size_t size, int corrupt)
+{
+    struct sim * sim = dev->sim;
+    int value;
+
+    // Keep the value wandering between 0 and 100
+    dev->value += (int)(next_random(sim) % 2001) - 1000;
+    if (dev->value < 0) {
+        dev->value = -dev->value;
+    } else if (dev->value > 100000) {
+        dev->value = 200000 - dev->value;
+    }
+    value = dev->value;
+    dev->measure++;
+
+    if (!corrupt) {
+        return snprintf(buf, size, "StringFromSensor%u_%u_%d.%03d\n",
+                dev->id, dev->measure, value / 1000, value % 1000);
+    }
+
+    // One of the failures parse_frame() tells apart
+    switch (next_random(sim) % 4) {
+        case 0:
+            return snprintf(buf, size, "StringFromSenser%u_%u_%d.%03d\n",
+                    dev->id, dev->measure, value / 1000, value % 1000);
+        case 1:
+            return snprintf(buf, size, "StringFromSensor%u_%u_%d.%03dx\n",
+                    dev->id, dev->measure, value / 1000, value % 1000);
+        case 2:
+            return snprintf(buf, size, "StringFromSensor%u_%u\n", dev->id, dev->measure);
+        default:
+            return snprintf(buf, size, "StringFromSensor%u_%u_%d,%03d\n",
+                    dev->id, dev->measure, value / 1000, value % 1000);
+    }
+}
+
+
+/**
+ * Writes a response, possibly preceded by an oversize frame and followed
+ * by an extra one, in a single write() as a sensor flushing its UART
+ * would. A response which does not fit in the pty is lost.
+ */
+static void respond(struct sim_device * dev, long long requested)
+{
+    struct sim * sim = dev->sim;
+    char buf[OVERSIZE + 128];
+    int corrupt = chance(sim, sim->config.malformed);
+    int len = 0;
+    ssize_t written;
+
+    if (chance(sim, sim->config.oversize)) {
+        memset(buf, 'X', OVERSIZE);
+        buf[OVERSIZE] = '\n';
+        len = OVERSIZE + 1;
+        sim->stats.oversize++;
+    }
+
+    len += format_frame(dev, buf + len, sizeof(buf) - len, corrupt);
+
+    if (chance(sim, sim->config.burst)) {
+        len += format_frame(dev, buf + len, sizeof(buf) - len, 0);
+        sim->stats.burst++;
+    }
+
+    written = write(dev->master, buf, len);
+    if (written != len) {
+        sim->stats.overruns++;
+        return;
+    }
+
+    if (corrupt) {
+        sim->stats.malformed++;
+    } else {
+        sim->stats.responses++;
+        if (sim->on_response != NULL) {
+            sim->on_response(dev, requested);
+        }
+    }
+}
+
+
+/**
+ * Arms the timer of the next frame of a stream, due streamed periods
+ * after its origin, computed in us for rates which do not divide a
+ * second. The wheel counts ms: never early, at most 1 ms late.
+ */
+static void arm_stream(struct sim_device * dev)
+{
+    struct sim * sim = dev->sim;
+    long long due = dev->origin + (long long)(dev->streamed * 1000000 / sim->config.rate);
+
+    wheel_arm(&sim->wheel, &dev->timer, (due + 999) / 1000);
+}
+
+
+static void response_due(struct timer * timer)
+{
+    struct sim_device * dev = (struct sim_device *)timer;
+    struct sim * sim = dev->sim;
+    struct sim_response * response;
+
+    if (sim->config.rate > 0) {
+        // Streaming: keep an absolute period so that lateness does not pile up
+        if (chance(sim, sim->config.drop)) {
+            sim->stats.dropped++;
+        } else {
+            respond(dev, now_us());
+        }
+        dev->streamed++;
+        arm_stream(dev);
+        return;
+    }
+
+    response = &dev->queue[dev->first];
+    dev->first = (dev->first + 1) % SIM_QUEUE;
+    dev->pending--;
+    respond(dev, response->requested);
+
+    if (dev->pending > 0) {
+        wheel_arm(&sim->wheel, &dev->timer, dev->queue[dev->first].due);
+    }
+}
+
+
+/**
+ * Schedules the response to a "get". Responses leave in the order the
+ * requests came in, a slow one delays the following ones like on a real
+ * serial line.
+ */
+static void schedule(struct sim_device * dev, long long requested)
+{
+    struct sim * sim = dev->sim;
+    struct sim_response * response;
+    long long due;
+
+    sim->stats.requests++;
+    if (chance(sim, sim->config.drop)) {
+        sim->stats.dropped++;
+        return;
+    }
+    if (dev->pending == SIM_QUEUE) {
+        sim->stats.overruns++;
+        return;
+    }
+
+    due = requested / 1000 + sim->config.delay;
+    if (sim->config.jitter > 0) {
+        due += next_random(sim) % (sim->config.jitter + 1);
+    }
+    if (dev->pending > 0) {
+        response = &dev->queue[(dev->first + dev->pending - 1) % SIM_QUEUE];
+        if (due < response->due) {
+            due = response->due;
+        }
+    }
+
+    response = &dev->queue[(dev->first + dev->pending) % SIM_QUEUE];
+    response->due = due;
+    response->requested = requested;
+    if (dev->pending++ == 0) {
+        wheel_arm(&sim->wheel, &dev->timer, due);
+    }
+}
+
+
+/**
+ * Reads whatever the acquisition side wrote and looks for "get" in it,
+ * across reads if need be.
+ */
+static int handle_input(struct sim_device * dev)
+{
+    char buf[256];
+    long long now;
+    ssize_t size;
+    ssize_t i;
+
+    while ((size = read(dev->master, buf, sizeof(buf))) > 0) {
+        now = now_us();
+        for (i = 0; i < size; i++) {
+            if (buf[i] == REQUEST[dev->matched]) {
+                dev->matched++;
+            } else {
+                dev->matched = (buf[i] == REQUEST[0]);
+            }
+            if (dev->matched == REQUEST_LEN) {
+                dev->matched = 0;
+                if (dev->sim->config.rate == 0) {
+                    schedule(dev, now);
+                }
+            }
+        }
+    }
+
+    return size < 0 && errno != EAGAIN ? -1 : 0;
+}
+
+
+/**
+ * Opens a pty pair. The slave stays open on our side too, so that the
+ * master does not hang up between two runs of the acquisition side, and
+ * is put in raw mode so that nothing gets echoed before it is configured.
+ */
+static int open_device(struct sim_device * dev)
+{
+    struct termios conf;
+    char * name;
+
+    dev->master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (dev->master < 0) {
+        return -1;
+    }
+    if (grantpt(dev->master) < 0 || unlockpt(dev->master) < 0 || (name = ptsname(dev->master)) == NULL) {
+        return -1;
+    }
+    snprintf(dev->path, sizeof(dev->path), "%s", name);
+
+    dev->slave = open(dev->path, O_RDWR | O_NOCTTY);
+    if (dev->slave < 0 || tcgetattr(dev->slave, &conf) < 0) {
+        return -1;
+    }
+    cfmakeraw(&conf);
+    if (tcsetattr(dev->slave, TCSANOW, &conf) < 0) {
+        return -1;
+    }
+
+    return fcntl(dev->master, F_SETFL, O_NONBLOCK);
+}
+
+
+int sim_init(struct sim * sim, const struct sim_config * config, int count)
+{
+    struct epoll_event ev;
+    int i;
+
+    memset(sim, 0, sizeof(*sim));
+    sim->config = *config;
+    sim->seed = 2463534242U;
+    sim->epfd = -1;
+
+    if (count < 1 || config->rate < 0 || config->rate > 1000) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    sim->devices = calloc(count, sizeof(*sim->devices));
+    if (sim->devices == NULL) {
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        sim->devices[i].master = -1;
+        sim->devices[i].slave = -1;
+    }
+    sim->count = count;
+
+    wheel_init(&sim->wheel, now_us() / 1000);
+
+    sim->epfd = epoll_create(count);
+    if (sim->epfd < 0) {
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        struct sim_device * dev = &sim->devices[i];
+
+        dev->sim = sim;
+        dev->id = i + 1;
+        dev->value = next_random(sim) % 100000;
+        timer_init(&dev->timer, response_due);
+
+        if (open_device(dev) < 0) {
+            return -1;
+        }
+
+        ev.events = EPOLLIN;
+        ev.data.ptr = dev;
+        if (epoll_ctl(sim->epfd, EPOLL_CTL_ADD, dev->master, &ev) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+int sim_run(struct sim * sim, volatile int * stop, long duration)
+{
+    struct epoll_event events[MAX_EVENTS];
+    long long start = now_us() / 1000;
+    long long now;
+    long long next;
+    long timeout;
+    int count;
+    int i;
+
+    // Spread the streams over a period rather than sending all at once
+    for (i = 0; sim->config.rate > 0 && i < sim->count; i++) {
+        sim->devices[i].origin = (start + 1) * 1000 + (long long)i * 1000000 / sim->config.rate / sim->count;
+        sim->devices[i].streamed = 0;
+        arm_stream(&sim->devices[i]);
+    }
+
+    while (*stop == 0) {
+        now = now_us() / 1000;
+        if (duration > 0 && now - start >= duration) {
+            break;
+        }
+        wheel_advance(&sim->wheel, now);
+
+        next = wheel_next(&sim->wheel);
+        timeout = next < 0 ? IDLE_TIMEOUT : next - now;
+        if (duration > 0 && start + duration - now < timeout) {
+            timeout = start + duration - now;
+        }
+
+        count = epoll_wait(sim->epfd, events, MAX_EVENTS, timeout);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            return -1;
+        }
+
+        for (i = 0; i < count; i++) {
+            if (handle_input(events[i].data.ptr) < 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+void sim_close(struct sim * sim)
+{
+    int i;
+
+    for (i = 0; i < sim->count; i++) {
+        if (sim->devices[i].slave >= 0) {
+            close(sim->devices[i].slave);
+        }
+        if (sim->devices[i].master >= 0) {
+            close(sim->devices[i].master);
+        }
+    }
+    if (sim->epfd >= 0) {
+        close(sim->epfd);
+    }
+    free(sim->devices);
+    sim->devices = NULL;
+    sim->count = 0;
+}
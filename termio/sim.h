@@ -0,0 +1,93 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include "wheel.h"
+
+
+/**
+ * Pseudo-terminal sensor simulator. Every simulated device is a pty whose
+ * slave side can be opened by any of the acquisition variants like a real
+ * serial line; the simulator answers "get" on the master side with
+ * StringFromSensor<id>_<n>_<value>\n frames, or streams them unsolicited.
+ */
+
+// Responses scheduled but not sent yet, per device
+#define SIM_QUEUE 64
+
+
+struct sim_config {
+    int delay;                  // Response delay (ms)
+    int jitter;                 // Added uniformly random delay (ms)
+    int drop;                   // Unanswered requests, or skipped frames when streaming (per mille)
+    int malformed;              // Responses with a corrupted frame (per mille)
+    int oversize;               // Responses preceded by an oversize frame (per mille)
+    int burst;                  // Responses followed by an extra frame (per mille)
+    int rate;                   // Unsolicited frames per second, 0 to answer "get"
+};
+
+struct sim_stats {
+    unsigned long requests;
+    unsigned long responses;
+    unsigned long dropped;
+    unsigned long malformed;
+    unsigned long oversize;
+    unsigned long burst;
+    unsigned long overruns;     // Responses lost to a full queue or pty
+};
+
+struct sim;
+
+struct sim_response {
+    long long due;              // In ms
+    long long requested;        // When the "get" was read, in us
+};
+
+struct sim_device {
+    struct timer timer;         // Next response (or stream frame) due
+    struct sim * sim;
+    int master;
+    int slave;                  // Kept open so the master never hangs up
+    char path[64];
+    unsigned int id;
+    unsigned int measure;
+    int value;                  // Random walk, in thousandths
+    int matched;                // Characters of "get" matched so far
+    long long origin;           // When the stream started (us)
+    unsigned long long streamed;    // Stream frames due so far
+    struct sim_response queue[SIM_QUEUE];   // FIFO of scheduled responses
+    int first;
+    int pending;
+};
+
+struct sim {
+    struct sim_config config;
+    struct sim_stats stats;
+    struct sim_device * devices;
+    int count;
+    int epfd;
+    struct wheel wheel;
+    unsigned int seed;
+
+    // Optional hook called for every well-formed response sent, with the
+    // time (in us) at which its request was read, for latency tracking
+    void (*on_response)(struct sim_device * dev, long long requested);
+};
+
+
+/**
+ * Creates count simulated devices. Returns -1 with errno set on failure.
+ */
+int sim_init(struct sim * sim, const struct sim_config * config, int count);
+
+/**
+ * Runs the simulation until *stop becomes non zero or, if duration is
+ * positive, for duration ms. Returns -1 with errno set on failure.
+ */
+int sim_run(struct sim * sim, volatile int * stop, long duration);
+
+/**
+ * Closes every device and frees the simulator.
+ */
+void sim_close(struct sim * sim);
+
+#endif
@@ -0,0 +1,313 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "fixed.h"
+#include "sink.h"
+
+
+static const char * const format_names[] = {
+    [SINK_HUMAN] = "human",
+    [SINK_CSV] = "csv",
+    [SINK_JSON] = "json",
+    [SINK_BINARY] = "binary",
+};
+
+
+static long long clock_us(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+static char * put_string(char * p, const char * str)
+{
+    size_t len = strlen(str);
+
+    memcpy(p, str, len);
+    return p + len;
+}
+
+
+/**
+ * Writes frame between double quotes, control characters escaped.
+ */
+static char * put_escaped(char * p, const char * frame, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    unsigned char c;
+    size_t i;
+
+    *p++ = '"';
+    for (i = 0; i < len; i++) {
+        c = frame[i];
+        switch (c) {
+            case '\t': *p++ = '\\'; *p++ = 't'; break;
+            case '\n': *p++ = '\\'; *p++ = 'n'; break;
+            case '\r': *p++ = '\\'; *p++ = 'r'; break;
+            default:
+                if (c < 32 || c == 127) {
+                    *p++ = '\\';
+                    *p++ = 'x';
+                    *p++ = hex[c >> 4];
+                    *p++ = hex[c & 15];
+                } else {
+                    *p++ = c;
+                }
+        }
+    }
+    *p++ = '"';
+    return p;
+}
+
+
+int sink_format_find(const char * name)
+{
+    int i;
+
+    for (i = 0; i < (int)(sizeof(format_names) / sizeof(format_names[0])); i++) {
+        if (strcmp(format_names[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+const char * sink_format_name(enum sink_format format)
+{
+    return format_names[format];
+}
+
+
+void sink_init(struct sink * sink, int fd, enum sink_format format, size_t threshold, long delay)
+{
+    memset(sink->used, 0, sizeof(sink->used));
+    sink->fd = fd;
+    sink->format = format;
+    sink->threshold = threshold < sizeof(sink->chunks) ? threshold : sizeof(sink->chunks);
+    sink->delay = delay * 1000;
+    sink->current = 0;
+    sink->pending = 0;
+    sink->oldest = 0;
+    sink->records = 0;
+    sink->flushes = 0;
+    sink->bytes = 0;
+}
+
+
+int sink_flush(struct sink * sink)
+{
+    struct iovec iov[SINK_CHUNKS];
+    struct iovec * next = iov;
+    ssize_t size;
+    int count = 0;
+    int i;
+
+    if (sink->pending == 0) {
+        return 0;
+    }
+
+    for (i = 0; i <= sink->current; i++) {
+        if (sink->used[i] > 0) {
+            iov[count].iov_base = sink->chunks[i];
+            iov[count].iov_len = sink->used[i];
+            count++;
+        }
+    }
+
+    // Every chunk in a single system call, as long as the fd takes it all
+    while (count > 0) {
+        size = writev(sink->fd, next, count);
+        if (size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        sink->bytes += size;
+        while (count > 0 && (size_t)size >= next->iov_len) {
+            size -= next->iov_len;
+            next++;
+            count--;
+        }
+        if (count > 0) {
+            next->iov_base = (char *)next->iov_base + size;
+            next->iov_len -= size;
+        }
+    }
+
+    memset(sink->used, 0, sizeof(sink->used));
+    sink->current = 0;
+    sink->pending = 0;
+    sink->flushes++;
+    return 0;
+}
+
+
+/**
+ * Returns room for a record of up to SINK_RECORD bytes, flushing if every
+ * chunk is taken.
+ */
+static char * reserve(struct sink * sink)
+{
+    if (sink->used[sink->current] + SINK_RECORD > SINK_CHUNK) {
+        if (sink->current + 1 == SINK_CHUNKS) {
+            if (sink_flush(sink) < 0) {
+                return NULL;
+            }
+        } else {
+            sink->current++;
+        }
+    }
+    if (sink->pending == 0) {
+        sink->oldest = clock_us(CLOCK_MONOTONIC);
+    }
+    return sink->chunks[sink->current] + sink->used[sink->current];
+}
+
+
+static int commit(struct sink * sink, char * end)
+{
+    char * start = sink->chunks[sink->current] + sink->used[sink->current];
+    size_t len = end - start;
+
+    sink->used[sink->current] += len;
+    sink->pending += len;
+    sink->records++;
+
+    if (sink->pending >= sink->threshold) {
+        return sink_flush(sink);
+    }
+    return 0;
+}
+
+
+int sink_sample(struct sink * sink, const struct sample * sample)
+{
+    struct sink_record record;
+    char * p = reserve(sink);
+
+    if (p == NULL) {
+        return -1;
+    }
+
+    switch (sink->format) {
+        case SINK_HUMAN:
+            p = put_string(p, " + New value received from sensor: ");
+            p = format_uint(p, sample->sensor, 1);
+            *p++ = ' ';
+            p = format_uint(p, sample->measure, 1);
+            *p++ = ' ';
+            p = format_fixed(p, sample->value, 3, 8);
+            *p++ = '\n';
+            break;
+        case SINK_CSV:
+            p = format_uint(p, clock_us(CLOCK_REALTIME), 1);
+            *p++ = ',';
+            p = format_uint(p, sample->sensor, 1);
+            *p++ = ',';
+            p = format_uint(p, sample->measure, 1);
+            *p++ = ',';
+            p = format_fixed(p, sample->value, -1, 0);
+            *p++ = '\n';
+            break;
+        case SINK_JSON:
+            p = put_string(p, "{\"time\":");
+            p = format_uint(p, clock_us(CLOCK_REALTIME), 1);
+            p = put_string(p, ",\"sensor\":");
+            p = format_uint(p, sample->sensor, 1);
+            p = put_string(p, ",\"measure\":");
+            p = format_uint(p, sample->measure, 1);
+            p = put_string(p, ",\"value\":");
+            p = format_fixed(p, sample->value, -1, 0);
+            p = put_string(p, "}\n");
+            break;
+        case SINK_BINARY:
+            record.time = clock_us(CLOCK_REALTIME);
+            record.sensor = sample->sensor;
+            record.measure = sample->measure;
+            record.value = sample->value.mantissa;
+            record.scale = sample->value.scale;
+            record.reserved = 0;
+            memcpy(p, &record, sizeof(record));
+            p += sizeof(record);
+            break;
+    }
+
+    return commit(sink, p);
+}
+
+
+int sink_text(struct sink * sink, const char * text)
+{
+    size_t len = strlen(text);
+    char * p;
+
+    if (sink->format != SINK_HUMAN) {
+        return 0;
+    }
+    if ((p = reserve(sink)) == NULL) {
+        return -1;
+    }
+    if (len > SINK_RECORD) {
+        len = SINK_RECORD;
+    }
+    memcpy(p, text, len);
+    return commit(sink, p + len);
+}
+
+
+int sink_rejected(struct sink * sink, const char * reason, const char * frame, size_t len)
+{
+    size_t shown = len;
+    char * p;
+
+    if (sink->format != SINK_HUMAN) {
+        return 0;
+    }
+    if ((p = reserve(sink)) == NULL) {
+        return -1;
+    }
+    // Escaping takes up to 4 bytes per character, the reason has to fit too
+    if (shown > (SINK_RECORD - 128) / 4) {
+        shown = (SINK_RECORD - 128) / 4;
+    }
+
+    p = put_string(p, " - Received data has wrong format (");
+    p = put_string(p, reason);
+    p = put_string(p, "). Received string (");
+    p = format_uint(p, len, 1);
+    p = put_string(p, " bytes) is: ");
+    p = put_escaped(p, frame, shown);
+    *p++ = '\n';
+
+    return commit(sink, p);
+}
+
+
+int sink_due(struct sink * sink)
+{
+    long long left;
+
+    if (sink->pending == 0) {
+        return -1;
+    }
+    left = sink->oldest + sink->delay - clock_us(CLOCK_MONOTONIC);
+    return left > 0 ? (int)((left + 999) / 1000) : 0;
+}
+
+
+int sink_tick(struct sink * sink)
+{
+    if (sink_due(sink) == 0) {
+        return sink_flush(sink);
+    }
+    return 0;
+}
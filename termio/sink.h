@@ -0,0 +1,117 @@
+#ifndef SINK_H
+#define SINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parser.h"
+
+
+/**
+ * Batched output of the samples. Records are formatted by hand (no stdio)
+ * into a chain of chunks, which are written at once with writev() when
+ * the amount pending reaches a threshold or the oldest pending record
+ * gets too old, whichever comes first.
+ */
+
+#define SINK_CHUNK 8192
+#define SINK_CHUNKS 8
+
+// Largest record, including an escaped frame in the human format
+#define SINK_RECORD 512
+
+// Default flush thresholds
+#define SINK_THRESHOLD 32768
+#define SINK_DELAY 100
+
+
+enum sink_format {
+    SINK_HUMAN,                 // What the acquisition always printed
+    SINK_CSV,                   // time_us,sensor,measure,value (as sent)
+    SINK_JSON,                  // One object per line
+    SINK_BINARY,                // struct sink_record, native byte order
+};
+
+/**
+ * A sample in the binary format, 32 bytes without padding.
+ */
+struct sink_record {
+    int64_t time;               // Wall clock (us since the epoch)
+    uint32_t sensor;
+    uint32_t measure;
+    int64_t value;              // Fixed-point mantissa...
+    int32_t scale;              // ...and its number of decimals
+    uint32_t reserved;
+};
+
+struct sink {
+    int fd;
+    enum sink_format format;
+    size_t threshold;           // Bytes pending which trigger a flush
+    long delay;                 // Age of the oldest pending record which does (us)
+
+    char chunks[SINK_CHUNKS][SINK_CHUNK];
+    size_t used[SINK_CHUNKS];
+    int current;                // Chunk being filled
+    size_t pending;
+    long long oldest;           // When the first pending record was added (us)
+
+    unsigned long records;
+    unsigned long flushes;
+    unsigned long long bytes;
+};
+
+
+/**
+ * Returns the format with the given name (human, csv, json or binary), or
+ * -1.
+ */
+int sink_format_find(const char * name);
+
+/**
+ * Returns the name of a format.
+ */
+const char * sink_format_name(enum sink_format format);
+
+/**
+ * Initializes a sink writing to fd. threshold is capped to the size of the
+ * buffer, delay is in ms.
+ */
+void sink_init(struct sink * sink, int fd, enum sink_format format, size_t threshold, long delay);
+
+/**
+ * Adds a sample. Returns -1 with errno set if a flush failed.
+ */
+int sink_sample(struct sink * sink, const struct sample * sample);
+
+/**
+ * Adds a line of text, only in the human format (the others only carry
+ * samples). Returns -1 with errno set if a flush failed.
+ */
+int sink_text(struct sink * sink, const char * text);
+
+/**
+ * Adds the report of a rejected frame, escaping its content, only in the
+ * human format. Returns -1 with errno set if a flush failed.
+ */
+int sink_rejected(struct sink * sink, const char * reason, const char * frame, size_t len);
+
+/**
+ * Writes everything pending. Returns -1 with errno set on failure.
+ */
+int sink_flush(struct sink * sink);
+
+/**
+ * Flushes if the oldest pending record is older than the delay. Returns
+ * -1 with errno set on failure.
+ */
+int sink_tick(struct sink * sink);
+
+/**
+ * Returns the ms left before the pending records must be flushed, 0 if
+ * they already must, or -1 if nothing is pending. Meant to compute the
+ * timeout of poll() and friends.
+ */
+int sink_due(struct sink * sink);
+
+#endif
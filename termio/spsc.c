@@ -0,0 +1,93 @@
+#include <stdlib.h>
+#include <errno.h>
+
+#include "spsc.h"
+
+
+int spsc_init(struct spsc * spsc, unsigned int capacity, size_t slot_size)
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0 || slot_size == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // Keep every slot on cache lines of its own, so that the producer
+    // filling one does not disturb the consumer reading the previous one
+    slot_size = (slot_size + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+
+    spsc->slots = malloc(capacity * slot_size);
+    if (spsc->slots == NULL) {
+        return -1;
+    }
+    spsc->slot_size = slot_size;
+    spsc->mask = capacity - 1;
+    spsc->head = 0;
+    spsc->tail = 0;
+    spsc->tail_cache = 0;
+    spsc->head_cache = 0;
+
+    return 0;
+}
+
+
+void spsc_destroy(struct spsc * spsc)
+{
+    free(spsc->slots);
+    spsc->slots = NULL;
+}
+
+
+void * spsc_claim(struct spsc * spsc)
+{
+    unsigned int head = spsc->head;
+
+    if (head - spsc->tail_cache > spsc->mask) {
+        spsc->tail_cache = spsc->tail;
+        if (head - spsc->tail_cache > spsc->mask) {
+            return NULL;
+        }
+        // Do not let the slot be written before the consumer is done with it
+        __sync_synchronize();
+    }
+
+    return spsc->slots + (head & spsc->mask) * spsc->slot_size;
+}
+
+
+void spsc_publish(struct spsc * spsc)
+{
+    // The content of the slot must be visible before the new head
+    __sync_synchronize();
+    spsc->head = spsc->head + 1;
+}
+
+
+void * spsc_peek(struct spsc * spsc)
+{
+    unsigned int tail = spsc->tail;
+
+    if (tail == spsc->head_cache) {
+        spsc->head_cache = spsc->head;
+        if (tail == spsc->head_cache) {
+            return NULL;
+        }
+        // Do not read the slot before the head saying it is published
+        __sync_synchronize();
+    }
+
+    return spsc->slots + (tail & spsc->mask) * spsc->slot_size;
+}
+
+
+void spsc_release(struct spsc * spsc)
+{
+    // Done reading the slot before the producer may reuse it
+    __sync_synchronize();
+    spsc->tail = spsc->tail + 1;
+}
+
+
+unsigned int spsc_count(struct spsc * spsc)
+{
+    return spsc->head - spsc->tail;
+}
@@ -0,0 +1,79 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stddef.h>
+
+
+/**
+ * Bounded lock-free single-producer/single-consumer ring of fixed-size
+ * slots. Slots are filled and drained in place (claim/publish on the
+ * producer side, peek/release on the consumer side), nothing is copied.
+ *
+ * Each side owns its index on a cache line of its own and keeps a cached
+ * copy of the other side's index, which it only refreshes when the ring
+ * looks full (resp. empty): in the steady state the two threads do not
+ * share any written cache line but the slots themselves.
+ *
+ * Built on the __sync builtins, for the older toolchains.
+ */
+
+// Upper bound of the cache line sizes we run on (32 bytes on the ARM926)
+#define CACHE_LINE 64
+
+
+struct spsc {
+    // Producer side
+    volatile unsigned int head __attribute__((aligned(CACHE_LINE)));
+    unsigned int tail_cache;
+
+    // Consumer side
+    volatile unsigned int tail __attribute__((aligned(CACHE_LINE)));
+    unsigned int head_cache;
+
+    // Read only once initialized
+    char * slots __attribute__((aligned(CACHE_LINE)));
+    size_t slot_size;
+    unsigned int mask;
+};
+
+
+/**
+ * Allocates a ring of capacity slots of slot_size bytes, capacity being a
+ * power of two. Returns -1 with errno set on failure.
+ */
+int spsc_init(struct spsc * spsc, unsigned int capacity, size_t slot_size);
+
+/**
+ * Frees the slots.
+ */
+void spsc_destroy(struct spsc * spsc);
+
+/**
+ * Producer: returns the next free slot, or NULL if the ring is full. The
+ * slot only becomes visible to the consumer once published.
+ */
+void * spsc_claim(struct spsc * spsc);
+
+/**
+ * Producer: hands the slot returned by spsc_claim() over to the consumer.
+ */
+void spsc_publish(struct spsc * spsc);
+
+/**
+ * Consumer: returns the oldest published slot, or NULL if the ring is
+ * empty.
+ */
+void * spsc_peek(struct spsc * spsc);
+
+/**
+ * Consumer: gives the slot returned by spsc_peek() back to the producer.
+ */
+void spsc_release(struct spsc * spsc);
+
+/**
+ * Number of published slots not released yet. Exact from either side,
+ * an estimate from any other thread.
+ */
+unsigned int spsc_count(struct spsc * spsc);
+
+#endif
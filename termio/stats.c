@@ -0,0 +1,835 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "fixed.h"
+#include "stats.h"
+
+
+#define SNAPSHOT_MAGIC "TIOSTAT"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HEADER 16
+
+// Fixed part of a series in a snapshot, before its level sizes and items
+#define SNAPSHOT_SERIES 72
+
+
+static const int ewma_shifts[STATS_EWMAS] = STATS_EWMA_SHIFTS;
+
+
+/**
+ * Capacity of a level of a sketch of so many levels: K at the top, 2/3
+ * of the level above (rounded up) below, never less than MIN.
+ */
+static unsigned int level_capacity(unsigned int level, unsigned int levels)
+{
+    unsigned int capacity = STATS_SKETCH_K;
+    unsigned int depth;
+
+    for (depth = levels - 1 - level; depth > 0 && capacity > STATS_SKETCH_MIN; depth--) {
+        capacity = (2 * capacity + 2) / 3;
+    }
+    return capacity > STATS_SKETCH_MIN ? capacity : STATS_SKETCH_MIN;
+}
+
+
+static unsigned int sketch_capacity(unsigned int levels)
+{
+    unsigned int capacity = 0;
+    unsigned int level;
+
+    for (level = 0; level < levels; level++) {
+        capacity += level_capacity(level, levels);
+    }
+    return capacity;
+}
+
+
+/**
+ * Index of the first item of a level, the levels above coming first.
+ */
+static unsigned int level_start(const struct stats_sketch * sketch, unsigned int level)
+{
+    unsigned int start = 0;
+    unsigned int h;
+
+    for (h = level + 1; h < sketch->levels; h++) {
+        start += sketch->sizes[h];
+    }
+    return start;
+}
+
+
+static void add_level(struct stats_sketch * sketch)
+{
+    // The new top level comes first and is empty, nothing moves
+    sketch->sizes[sketch->levels++] = 0;
+    sketch->capacity = sketch_capacity(sketch->levels);
+}
+
+
+// xorshift32, which only has to be fair between the two halves
+static uint32_t next_random(struct stats_sketch * sketch)
+{
+    uint32_t x = sketch->random;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return sketch->random = x;
+}
+
+
+static int compare(const void * a, const void * b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+
+/**
+ * Halves a level: sorts it and promotes every other item, from the first
+ * or the second at random, to the end of the level above, which
+ * immediately precedes it. With an odd size, the smallest item stays. The
+ * levels below move down to close the gap.
+ */
+static void compact(struct stats_sketch * sketch, unsigned int level)
+{
+    unsigned int start, size, promoted, odd, offset, end, i;
+    int64_t * items;
+    int64_t kept;
+
+    // Only reached with more than STATS_MAX_COUNT samples otherwise
+    if (level + 1 == sketch->levels) {
+        add_level(sketch);
+    }
+
+    start = level_start(sketch, level);
+    size = sketch->sizes[level];
+    items = sketch->items + start;
+    qsort(items, size, sizeof(*items), compare);
+
+    odd = size & 1;
+    kept = items[0];
+    promoted = size / 2;
+    offset = odd + (next_random(sketch) & 1);
+    for (i = 0; i < promoted; i++) {
+        items[i] = items[offset + 2 * i];
+    }
+    if (odd) {
+        items[promoted] = kept;
+    }
+
+    end = start + size;
+    memmove(items + promoted + odd, sketch->items + end, (sketch->used - end) * sizeof(*items));
+    sketch->sizes[level + 1] += promoted;
+    sketch->sizes[level] = odd;
+    sketch->used -= promoted;
+}
+
+
+/**
+ * Compacts the lowest levels over their capacity until the sketch has
+ * room again. As long as it has none, some level is over its capacity.
+ */
+static void compress(struct stats_sketch * sketch)
+{
+    unsigned int level;
+
+    while (sketch->used >= sketch->capacity) {
+        level = 0;
+        while (sketch->sizes[level] < level_capacity(level, sketch->levels)) {
+            level++;
+        }
+        compact(sketch, level);
+    }
+}
+
+
+/**
+ * Adds an item standing for 2^level samples.
+ */
+static void insert(struct stats_sketch * sketch, unsigned int level, int64_t value)
+{
+    unsigned int end;
+
+    while (level >= sketch->levels) {
+        add_level(sketch);
+    }
+    end = level_start(sketch, level) + sketch->sizes[level];
+    memmove(sketch->items + end + 1, sketch->items + end, (sketch->used - end) * sizeof(*sketch->items));
+    sketch->items[end] = value;
+    sketch->sizes[level]++;
+    sketch->used++;
+    compress(sketch);
+}
+
+
+static void sketch_init(struct stats_sketch * sketch, unsigned int seed)
+{
+    sketch->levels = 1;
+    sketch->used = 0;
+    sketch->capacity = sketch_capacity(1);
+    sketch->sizes[0] = 0;
+    sketch->random = 2463534242U ^ seed;
+    if (sketch->random == 0) {
+        sketch->random = 2463534242U;
+    }
+}
+
+
+static struct stats_series * find(struct stats * stats, unsigned int sensor)
+{
+    unsigned int i;
+
+    for (i = 0; i < stats->series_count; i++) {
+        if (stats->series[i].sensor == sensor) {
+            return &stats->series[i];
+        }
+    }
+    return NULL;
+}
+
+
+const struct stats_series * stats_find(const struct stats * stats, unsigned int sensor)
+{
+    return find((struct stats *)stats, sensor);
+}
+
+
+void stats_init(struct stats * stats)
+{
+    // Series are cleared as they are taken, the table is left untouched
+    stats->series_count = 0;
+    stats->added = 0;
+    stats->rejected = 0;
+}
+
+
+static void wide_add(struct stats_wide * wide, uint64_t high, uint64_t low)
+{
+    wide->low += low;
+    wide->high += high + (wide->low < low);
+}
+
+
+/**
+ * Adds a deviation to the sum, and its square to the squares. Both halves
+ * of a 64-bit square are only needed past 32-bit deviations.
+ */
+static void accumulate(struct stats_series * series, int64_t deviation)
+{
+    uint64_t magnitude = deviation < 0 ? -(uint64_t)deviation : (uint64_t)deviation;
+    uint32_t low = magnitude;
+    uint32_t high = magnitude >> 32;
+    uint64_t cross;
+
+    wide_add(&series->sum, deviation < 0 ? UINT64_MAX : 0, deviation);
+    wide_add(&series->squares, 0, (uint64_t)low * low);
+    if (high != 0) {
+        // (h.2^32 + l)^2 = h^2.2^64 + 2hl.2^32 + l^2
+        cross = (uint64_t)high * low;
+        wide_add(&series->squares, (uint64_t)high * high + (cross >> 31), cross << 33);
+    }
+}
+
+
+int stats_add(struct stats * stats, const struct sample * sample)
+{
+    struct stats_series * series = find(stats, sample->sensor);
+    struct fixed value = sample->value;
+    int64_t x;
+    int error;
+    int i;
+
+    if (series == NULL) {
+        if (stats->series_count == STATS_MAX_SERIES) {
+            error = ENOSPC;
+            goto reject;
+        }
+        series = &stats->series[stats->series_count++];
+        memset(series, 0, offsetof(struct stats_series, sketch));
+        series->sensor = sample->sensor;
+        series->scale = value.scale;
+        sketch_init(&series->sketch, sample->sensor);
+    }
+
+    if (series->count == STATS_MAX_COUNT) {
+        error = EOVERFLOW;
+        goto reject;
+    }
+    if (value.scale != series->scale && fixed_rescale(&value, series->scale) < 0) {
+        error = ERANGE;
+        goto reject;
+    }
+
+    x = value.mantissa;
+    if (series->count == 0) {
+        series->min = x;
+        series->max = x;
+        for (i = 0; i < STATS_EWMAS; i++) {
+            series->ewma[i] = x * (1LL << STATS_EWMA_FRACTION);
+        }
+    }
+    series->count++;
+    if (x < series->min) {
+        series->min = x;
+    }
+    if (x > series->max) {
+        series->max = x;
+    }
+
+    if (series->batched++ == 0) {
+        series->origin = x;
+    }
+    accumulate(series, x - series->origin);
+    for (i = 0; i < STATS_EWMAS; i++) {
+        // Arithmetic shifts, rounding towards minus infinity
+        series->ewma[i] += (x * (1LL << STATS_EWMA_FRACTION) - series->ewma[i]) >> ewma_shifts[i];
+    }
+
+    series->sketch.items[series->sketch.used++] = value.mantissa;
+    series->sketch.sizes[0]++;
+    if (series->sketch.used >= series->sketch.capacity) {
+        compress(&series->sketch);
+    }
+
+    stats->added++;
+    return 0;
+
+reject:
+    stats->rejected++;
+    errno = error;
+    return -1;
+}
+
+
+static double wide_to_double(struct stats_wide wide)
+{
+    struct stats_wide negated;
+
+    // Small negative values would otherwise cancel out at 2^64 precision
+    if ((int64_t)wide.high < 0) {
+        negated.low = ~wide.low + 1;
+        negated.high = ~wide.high + (negated.low == 0);
+        return -wide_to_double(negated);
+    }
+    return ldexp((double)wide.high, 64) + (double)wide.low;
+}
+
+
+/**
+ * Mean and sum of the squared deviations from it of every sample of a
+ * series, the batched ones and the others combined (Chan et al., the
+ * parallel form of Welford's update).
+ */
+static void moments(const struct stats_series * series, double * mean, double * m2)
+{
+    unsigned long long others = series->count - series->batched;
+    double n = series->batched;
+    double sum, batch_mean, batch_m2, delta;
+
+    *mean = series->mean;
+    *m2 = series->m2;
+    if (series->batched == 0) {
+        return;
+    }
+
+    sum = wide_to_double(series->sum);
+    batch_mean = series->origin + sum / n;
+    batch_m2 = wide_to_double(series->squares) - sum * sum / n;
+    if (batch_m2 < 0) {
+        batch_m2 = 0;
+    }
+    if (others == 0) {
+        *mean = batch_mean;
+        *m2 = batch_m2;
+        return;
+    }
+    delta = batch_mean - series->mean;
+    *mean = series->mean + delta * n / series->count;
+    *m2 = series->m2 + batch_m2 + delta * delta * (others * n / series->count);
+}
+
+
+/**
+ * Unit of the mantissas of a series.
+ */
+static double unit(const struct stats_series * series)
+{
+    struct fixed one = { 1, series->scale };
+
+    return fixed_to_double(one);
+}
+
+
+double stats_mean(const struct stats_series * series)
+{
+    double mean, m2;
+
+    moments(series, &mean, &m2);
+    return mean * unit(series);
+}
+
+
+double stats_stddev(const struct stats_series * series)
+{
+    double mean, m2;
+
+    if (series->count < 2) {
+        return 0;
+    }
+    moments(series, &mean, &m2);
+    return sqrt(m2 / (series->count - 1)) * unit(series);
+}
+
+
+double stats_ewma(const struct stats_series * series, int index)
+{
+    return ldexp(series->ewma[index], -STATS_EWMA_FRACTION) * unit(series);
+}
+
+
+struct weighted {
+    int64_t value;
+    unsigned long long weight;
+};
+
+
+static int compare_weighted(const void * a, const void * b)
+{
+    return compare(&((const struct weighted *)a)->value, &((const struct weighted *)b)->value);
+}
+
+
+void stats_quantiles(const struct stats_series * series, const unsigned int * permilles,
+        int64_t * values, size_t count)
+{
+    const struct stats_sketch * sketch = &series->sketch;
+    struct weighted items[STATS_SKETCH_ITEMS];
+    unsigned long long target, seen;
+    unsigned int level, start, i, n = 0;
+    size_t q;
+
+    for (level = 0; level < sketch->levels; level++) {
+        start = level_start(sketch, level);
+        for (i = 0; i < sketch->sizes[level]; i++) {
+            items[n].value = sketch->items[start + i];
+            items[n++].weight = 1ULL << level;
+        }
+    }
+    qsort(items, n, sizeof(*items), compare_weighted);
+
+    for (q = 0; q < count; q++) {
+        if (permilles[q] == 0 || n == 0) {
+            values[q] = series->min;
+            continue;
+        }
+        if (permilles[q] >= 1000) {
+            values[q] = series->max;
+            continue;
+        }
+        target = (series->count * permilles[q] + 999) / 1000;
+        seen = 0;
+        for (i = 0; i < n - 1; i++) {
+            seen += items[i].weight;
+            if (seen >= target) {
+                break;
+            }
+        }
+        values[q] = items[i].value;
+    }
+}
+
+
+static double power_of_ten(int exponent)
+{
+    double power = 1;
+
+    for (; exponent > 0; exponent--) {
+        power *= 10;
+    }
+    for (; exponent < 0; exponent++) {
+        power /= 10;
+    }
+    return power;
+}
+
+
+int stats_merge(struct stats * stats, const struct stats_series * other)
+{
+    struct stats_series * series = find(stats, other->sensor);
+    const struct stats_sketch * sketch = &other->sketch;
+    int64_t items[STATS_SKETCH_ITEMS];
+    struct fixed min = { other->min, other->scale };
+    struct fixed max = { other->max, other->scale };
+    struct fixed item;
+    unsigned long long count;
+    unsigned int level, start, i;
+    double factor, mean, m2, delta;
+    int k;
+
+    if (other->count == 0) {
+        return 0;
+    }
+    if (series == NULL) {
+        if (stats->series_count == STATS_MAX_SERIES) {
+            errno = ENOSPC;
+            return -1;
+        }
+        series = &stats->series[stats->series_count++];
+        *series = *other;
+        return 0;
+    }
+    if (other->count > STATS_MAX_COUNT - series->count) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+
+    // Everything is checked before the series is touched
+    if (fixed_rescale(&min, series->scale) < 0 || fixed_rescale(&max, series->scale) < 0) {
+        return -1;
+    }
+    for (i = 0; i < sketch->used; i++) {
+        item.mantissa = sketch->items[i];
+        item.scale = other->scale;
+        if (fixed_rescale(&item, series->scale) < 0) {
+            return -1;
+        }
+        items[i] = item.mantissa;
+    }
+
+    // The batch folds into the doubles, then Chan et al. again
+    moments(series, &series->mean, &series->m2);
+    series->batched = 0;
+    memset(&series->sum, 0, sizeof(series->sum));
+    memset(&series->squares, 0, sizeof(series->squares));
+
+    factor = power_of_ten(series->scale - other->scale);
+    moments(other, &mean, &m2);
+    mean *= factor;
+    count = series->count + other->count;
+    delta = mean - series->mean;
+    series->m2 += m2 * factor * factor
+            + delta * delta * ((double)series->count * other->count / count);
+    series->mean += delta * other->count / count;
+    for (k = 0; k < STATS_EWMAS; k++) {
+        series->ewma[k] = llround(((double)series->ewma[k] * series->count
+                + (double)other->ewma[k] * factor * other->count) / count);
+    }
+    series->count = count;
+    if (min.mantissa < series->min) {
+        series->min = min.mantissa;
+    }
+    if (max.mantissa > series->max) {
+        series->max = max.mantissa;
+    }
+
+    for (level = 0; level < sketch->levels; level++) {
+        start = level_start(sketch, level);
+        for (i = 0; i < sketch->sizes[level]; i++) {
+            insert(&series->sketch, level, items[start + i]);
+        }
+    }
+    return 0;
+}
+
+
+static uint8_t * put(uint8_t * p, uint64_t value, int bytes)
+{
+    int i;
+
+    for (i = 0; i < bytes; i++) {
+        *p++ = value >> (8 * i);
+    }
+    return p;
+}
+
+
+static uint64_t get(const uint8_t ** p, int bytes)
+{
+    uint64_t value = 0;
+    int i;
+
+    for (i = 0; i < bytes; i++) {
+        value |= (uint64_t)*(*p)++ << (8 * i);
+    }
+    return value;
+}
+
+
+static uint8_t * put_double(uint8_t * p, double value)
+{
+    uint64_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    return put(p, bits, 8);
+}
+
+
+static double get_double(const uint8_t ** p)
+{
+    uint64_t bits = get(p, 8);
+    double value;
+
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+/**
+ * Writes a series as it is laid out in a snapshot, all little endian:
+ * sensor, scale, count, min, max, mean, m2, the averages, the number of
+ * levels and of items, then the size of every level and the items, top
+ * level first. Returns the end of what was written.
+ */
+static uint8_t * encode(uint8_t * p, const struct stats_series * series)
+{
+    const struct stats_sketch * sketch = &series->sketch;
+    double mean, m2;
+    unsigned int i;
+    int k;
+
+    moments(series, &mean, &m2);
+    p = put(p, series->sensor, 4);
+    p = put(p, series->scale, 4);
+    p = put(p, series->count, 8);
+    p = put(p, series->min, 8);
+    p = put(p, series->max, 8);
+    p = put_double(p, mean);
+    p = put_double(p, m2);
+    for (k = 0; k < STATS_EWMAS; k++) {
+        p = put_double(p, ldexp(series->ewma[k], -STATS_EWMA_FRACTION));
+    }
+    p = put(p, sketch->levels, 4);
+    p = put(p, sketch->used, 4);
+    for (i = 0; i < sketch->levels; i++) {
+        p = put(p, sketch->sizes[i], 4);
+    }
+    for (i = 0; i < sketch->used; i++) {
+        p = put(p, sketch->items[i], 8);
+    }
+    return p;
+}
+
+
+/**
+ * Reads a series of a snapshot, checking that it holds together. Returns
+ * -1 with errno set to EINVAL if it does not, or it is truncated.
+ */
+static int decode(const uint8_t ** p, const uint8_t * end, struct stats_series * series)
+{
+    struct stats_sketch * sketch = &series->sketch;
+    unsigned long long weight = 0;
+    unsigned int used = 0;
+    unsigned int i;
+    int k;
+
+    if (end - *p < SNAPSHOT_SERIES) {
+        goto invalid;
+    }
+    series->sensor = get(p, 4);
+    series->scale = (int32_t)get(p, 4);
+    series->count = get(p, 8);
+    series->min = get(p, 8);
+    series->max = get(p, 8);
+    series->batched = 0;
+    series->origin = 0;
+    memset(&series->sum, 0, sizeof(series->sum));
+    memset(&series->squares, 0, sizeof(series->squares));
+    series->mean = get_double(p);
+    series->m2 = get_double(p);
+    for (k = 0; k < STATS_EWMAS; k++) {
+        series->ewma[k] = llround(ldexp(get_double(p), STATS_EWMA_FRACTION));
+    }
+    sketch->levels = get(p, 4);
+    sketch->used = get(p, 4);
+
+    if (series->scale < 0 || series->scale > FIXED_MAX_SCALE || series->count > STATS_MAX_COUNT
+            || sketch->levels == 0 || sketch->levels > STATS_SKETCH_LEVELS
+            || sketch->used > STATS_SKETCH_ITEMS
+            || (size_t)(end - *p) < sketch->levels * 4 + sketch->used * 8) {
+        goto invalid;
+    }
+    for (i = 0; i < sketch->levels; i++) {
+        sketch->sizes[i] = get(p, 4);
+        used += sketch->sizes[i];
+        weight += (unsigned long long)sketch->sizes[i] << i;
+    }
+    if (used != sketch->used || weight != series->count) {
+        goto invalid;
+    }
+    for (i = 0; i < sketch->used; i++) {
+        sketch->items[i] = get(p, 8);
+    }
+    sketch->capacity = sketch_capacity(sketch->levels);
+    sketch->random = 2463534242U ^ series->sensor;
+    if (sketch->used >= sketch->capacity) {
+        goto invalid;
+    }
+    return 0;
+
+invalid:
+    errno = EINVAL;
+    return -1;
+}
+
+
+int stats_save(const struct stats * stats, const char * path)
+{
+    char temporary[4096];
+    uint8_t * snapshot;
+    uint8_t * p;
+    size_t size = SNAPSHOT_HEADER;
+    ssize_t written;
+    unsigned int i;
+    int saved;
+    int fd;
+
+    if (snprintf(temporary, sizeof(temporary), "%s.tmp", path) >= (int)sizeof(temporary)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    for (i = 0; i < stats->series_count; i++) {
+        size += SNAPSHOT_SERIES + stats->series[i].sketch.levels * 4 + stats->series[i].sketch.used * 8;
+    }
+    snapshot = malloc(size);
+    if (snapshot == NULL) {
+        return -1;
+    }
+
+    memcpy(snapshot, SNAPSHOT_MAGIC, 8);
+    p = put(snapshot + 8, SNAPSHOT_VERSION, 4);
+    p = put(p, stats->series_count, 4);
+    for (i = 0; i < stats->series_count; i++) {
+        p = encode(p, &stats->series[i]);
+    }
+
+    fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        goto fail;
+    }
+    for (p = snapshot; p < snapshot + size; p += written) {
+        written = write(fd, p, snapshot + size - p);
+        if (written < 0 && errno != EINTR) {
+            close(fd);
+            goto fail;
+        }
+        if (written < 0) {
+            written = 0;
+        }
+    }
+    if (close(fd) < 0 || rename(temporary, path) < 0) {
+        goto fail;
+    }
+    free(snapshot);
+    return 0;
+
+fail:
+    saved = errno;
+    unlink(temporary);
+    free(snapshot);
+    errno = saved;
+    return -1;
+}
+
+
+int stats_load(struct stats * stats, const char * path)
+{
+    struct stats_series series;
+    struct stat st;
+    uint8_t * snapshot = NULL;
+    const uint8_t * p;
+    ssize_t got;
+    size_t size = 0;
+    unsigned int count, i;
+    int saved;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0) {
+        goto fail;
+    }
+    if (st.st_size < SNAPSHOT_HEADER) {
+        errno = EINVAL;
+        goto fail;
+    }
+    snapshot = malloc(st.st_size);
+    if (snapshot == NULL) {
+        goto fail;
+    }
+    while (size < (size_t)st.st_size) {
+        got = read(fd, snapshot + size, st.st_size - size);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0) {
+            goto fail;
+        }
+        if (got == 0) {
+            errno = EINVAL;
+            goto fail;
+        }
+        size += got;
+    }
+    close(fd);
+    fd = -1;
+
+    p = snapshot + 8;
+    if (memcmp(snapshot, SNAPSHOT_MAGIC, 8) != 0 || get(&p, 4) != SNAPSHOT_VERSION) {
+        errno = EINVAL;
+        goto fail;
+    }
+    count = get(&p, 4);
+    for (i = 0; i < count; i++) {
+        if (decode(&p, snapshot + size, &series) < 0 || stats_merge(stats, &series) < 0) {
+            goto fail;
+        }
+    }
+    free(snapshot);
+    return 0;
+
+fail:
+    saved = errno;
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(snapshot);
+    errno = saved;
+    return -1;
+}
+
+
+void stats_print(FILE * stream, const struct stats * stats, const char * name)
+{
+    static const unsigned int permilles[] = { 0, 500, 950, 990, 1000 };
+    const struct stats_series * series;
+    int64_t values[5];
+    char text[5][48];
+    struct fixed value;
+    unsigned int i;
+    int j;
+
+    for (i = 0; i < stats->series_count; i++) {
+        series = &stats->series[i];
+        stats_quantiles(series, permilles, values, 5);
+        for (j = 0; j < 5; j++) {
+            value.mantissa = values[j];
+            value.scale = series->scale;
+            *format_fixed(text[j], value, -1, 0) = '\0';
+        }
+        fprintf(stream, "%s %u: %llu samples, min %s p50 %s p95 %s p99 %s max %s, mean %.*f stddev %.*f ewma %.*f %.*f\n",
+                name, series->sensor, series->count, text[0], text[1], text[2], text[3], text[4],
+                series->scale + 1, stats_mean(series), series->scale + 1, stats_stddev(series),
+                series->scale, stats_ewma(series, 0), series->scale, stats_ewma(series, 1));
+    }
+}
@@ -0,0 +1,185 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parser.h"
+
+
+/**
+ * Running statistics of the values of every sensor, updated as samples
+ * are parsed: exact count, min and max, mean and variance,
+ * exponentially weighted averages, and quantiles estimated by a KLL
+ * sketch (Karnin, Lang and Liberty, "Optimal Quantile Approximation in
+ * Streams", 2016).
+ *
+ * The sketch keeps its items in levels, those of level h standing for
+ * 2^h samples each. New samples go to level 0. When the sketch is full,
+ * the lowest level over its capacity is sorted and every other item is
+ * promoted to the level above, the first or the second at random. Upper
+ * levels hold up to STATS_SKETCH_K items, lower ones 2/3 of the level
+ * above (but at least STATS_SKETCH_MIN): the memory is fixed, the cost
+ * of a sample is amortized O(1) (a sort of a level every so many
+ * samples), and the rank error of a quantile is about 1.7% with 99%
+ * confidence for the default K of 200.
+ *
+ * Values are fixed-point mantissas at the scale of the first sample of
+ * their sensor, later ones being rescaled to it. The APF27 has no FPU:
+ * adding a sample only takes integer arithmetic. The mean and variance
+ * come from 128-bit sums of the deviations from a first sample and of
+ * their squares, exact as long as the deviations stay under 2^46 units,
+ * and the averages are fixed-point, shifted rather than multiplied by
+ * their weights. Doubles only come in when a series is read, merged or
+ * saved: what was merged or loaded is kept as a double mean and sum of
+ * squared deviations, combined with the sums when needed.
+ *
+ * Every statistic merges: two sets of series, from two lines or two
+ * processes, combine into what a single one fed with both streams would
+ * give (the sketch within its error, the averages excepted, see
+ * stats_merge()). Snapshots are saved to files that any process can load
+ * into its own set.
+ */
+
+// Capacity of the upper levels of the sketches, which sets their accuracy
+#define STATS_SKETCH_K 200
+#define STATS_SKETCH_MIN 8
+#define STATS_SKETCH_LEVELS 32
+
+// What the levels hold at most, the capacities summing up to less than
+// 3 * K plus MIN per level
+#define STATS_SKETCH_ITEMS (3 * STATS_SKETCH_K + STATS_SKETCH_MIN * STATS_SKETCH_LEVELS)
+
+// Most samples a series takes, for its sketch never to need more levels
+#define STATS_MAX_COUNT ((1ULL << 34) - 1)
+
+#define STATS_MAX_SERIES 64
+
+// Exponentially weighted averages, over about 8 and 128 samples: their
+// weights are 2^-shift
+#define STATS_EWMAS 2
+#define STATS_EWMA_SHIFTS { 3, 7 }
+
+// Fractional bits of the averages, the values having to stay under 2^47
+// units
+#define STATS_EWMA_FRACTION 16
+
+// Period of the snapshots of the acquisition engine (us)
+#define STATS_PERIOD (10 * 1000000LL)
+
+
+struct stats_sketch {
+    unsigned int levels;
+    unsigned int used;
+    unsigned int capacity;          // Of the levels, once used reaches it they are compacted
+    uint32_t random;
+    unsigned int sizes[STATS_SKETCH_LEVELS];
+    int64_t items[STATS_SKETCH_ITEMS];  // Top level first, level 0 last
+};
+
+/**
+ * A 128-bit two's complement integer.
+ */
+struct stats_wide {
+    uint64_t high;
+    uint64_t low;
+};
+
+struct stats_series {
+    unsigned int sensor;
+    int scale;
+    unsigned long long count;
+    int64_t min, max;
+
+    // Samples added since the series was taken, loaded or merged into
+    unsigned long long batched;
+    int64_t origin;                 // The first of them
+    struct stats_wide sum;          // Of their deviations from it
+    struct stats_wide squares;      // Of the squares of those
+
+    // The others
+    double mean;
+    double m2;                      // Sum of the squared deviations from the mean
+
+    int64_t ewma[STATS_EWMAS];      // STATS_EWMA_FRACTION fractional bits
+    struct stats_sketch sketch;
+};
+
+struct stats {
+    struct stats_series series[STATS_MAX_SERIES];
+    unsigned int series_count;
+
+    unsigned long long added;
+    unsigned long rejected;
+};
+
+
+/**
+ * Initializes an empty set of series.
+ */
+void stats_init(struct stats * stats);
+
+/**
+ * Accounts for a sample. Returns -1 with errno set, counting the sample as
+ * rejected, if it does not fit the scale of its series (ERANGE), needs a
+ * new series when there is no room left (ENOSPC), or its series is full
+ * (EOVERFLOW).
+ */
+int stats_add(struct stats * stats, const struct sample * sample);
+
+/**
+ * Returns the series of a sensor, or NULL.
+ */
+const struct stats_series * stats_find(const struct stats * stats, unsigned int sensor);
+
+/**
+ * Mean, standard deviation (of the sample, 0 below two values) and
+ * exponentially weighted averages of a series, in the unit of the values.
+ */
+double stats_mean(const struct stats_series * series);
+double stats_stddev(const struct stats_series * series);
+double stats_ewma(const struct stats_series * series, int index);
+
+/**
+ * Estimates the values below which permilles[i] thousandths of the
+ * samples of the series fall, e.g. 990 for the 99th percentile, as
+ * mantissas at the scale of the series. 0 and 1000 give the exact min and
+ * max.
+ */
+void stats_quantiles(const struct stats_series * series, const unsigned int * permilles,
+        int64_t * values, size_t count);
+
+/**
+ * Merges another series into that of its sensor, which is created if
+ * needed. Every statistic but the weighted averages ends up as if the
+ * series had been fed with the samples of both: those are averaged,
+ * weighted by the sample counts, the order in which the samples of two
+ * streams would have interleaved being unknown. Returns -1 with errno set,
+ * leaving the set untouched, if the values do not fit the scale of the
+ * series (ERANGE), there is no room for a new series (ENOSPC), or the
+ * merged series would be too large (EOVERFLOW).
+ */
+int stats_merge(struct stats * stats, const struct stats_series * other);
+
+/**
+ * Writes a snapshot of every series to path, through a temporary file
+ * renamed over it: readers never see a partial snapshot. Returns -1 with
+ * errno set on failure.
+ */
+int stats_save(const struct stats * stats, const char * path);
+
+/**
+ * Merges the snapshot saved in path. Returns -1 with errno set on failure,
+ * EINVAL if the file is not a valid snapshot, leaving the series merged
+ * until then.
+ */
+int stats_load(struct stats * stats, const char * path);
+
+/**
+ * Prints one line per series, name and the sensor followed by the count,
+ * min, p50, p95, p99, max, mean, standard deviation and weighted averages.
+ */
+void stats_print(FILE * stream, const struct stats * stats, const char * name);
+
+#endif
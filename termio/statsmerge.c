@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "stats.h"
+
+
+/**
+ * Combines the statistics snapshots of several lines or processes (the
+ * -S option of the acquisition engine): the series of a sensor found in
+ * several of them are merged, and the result printed, and saved if asked
+ * to.
+ *
+ * Usage: statsmerge [-o PATH] SNAPSHOT...
+ */
+
+#define CHECKERR(val, fmt, ...) {               \
+    if ((val) < 0) {                            \
+        fprintf(stderr, fmt": ", __VA_ARGS__);  \
+        perror(NULL);                           \
+        exit(EXIT_FAILURE);                     \
+    }                                           \
+}
+
+
+// Too large for the stack
+static struct stats stats;
+
+
+void usage(const char * name)
+{
+    printf("Usage: %s [-o PATH] SNAPSHOT...\n", name);
+    printf("  -o  Also save the merged statistics to PATH\n");
+    exit(EXIT_FAILURE);
+}
+
+
+int main(int argc, char ** argv)
+{
+    const char * output = NULL;
+    int opt;
+    int i;
+
+    while ((opt = getopt(argc, argv, "o:")) != -1) {
+        switch (opt) {
+            case 'o': output = optarg; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind == argc) {
+        usage(argv[0]);
+    }
+
+    stats_init(&stats);
+    for (i = optind; i < argc; i++) {
+        CHECKERR(stats_load(&stats, argv[i]), "Failed to merge %s", argv[i]);
+    }
+    stats_print(stdout, &stats, "sensor");
+
+    if (output != NULL) {
+        CHECKERR(stats_save(&stats, output), "Failed to save statistics to %s", output);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,402 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "store.h"
+
+
+/**
+ * Index of the first time not before t in a sorted column.
+ */
+static size_t lower_bound(const int64_t * times, size_t n, int64_t t)
+{
+    size_t low = 0;
+    size_t high = n;
+    size_t middle;
+
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (times[middle] < t) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+
+/**
+ * The aggregation kernel: branchless, over a plain column, for the
+ * compiler to vectorize.
+ */
+static void aggregate(const int64_t * values, size_t n, struct store_bucket * bucket)
+{
+    int64_t min = bucket->min;
+    int64_t max = bucket->max;
+    int64_t sum = bucket->sum;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        min = values[i] < min ? values[i] : min;
+        max = values[i] > max ? values[i] : max;
+        sum += values[i];
+    }
+    bucket->min = min;
+    bucket->max = max;
+    bucket->sum = sum;
+    bucket->count += n;
+}
+
+
+static void merge(int64_t min, int64_t max, int64_t sum, size_t count, struct store_bucket * bucket)
+{
+    if (min < bucket->min) {
+        bucket->min = min;
+    }
+    if (max > bucket->max) {
+        bucket->max = max;
+    }
+    bucket->sum += sum;
+    bucket->count += count;
+}
+
+
+/**
+ * Aggregates the values [first, last) of a chunk: the blocks it covers
+ * through their summary, the values of those it cuts.
+ */
+static void aggregate_slice(const struct store_chunk * chunk, size_t first, size_t last,
+        struct store_bucket * bucket)
+{
+    size_t block = (first + STORE_BLOCK - 1) / STORE_BLOCK;
+    size_t end = last / STORE_BLOCK;
+
+    if (block >= end) {
+        aggregate(chunk->values + first, last - first, bucket);
+        return;
+    }
+    aggregate(chunk->values + first, block * STORE_BLOCK - first, bucket);
+    for (; block < end; block++) {
+        merge(chunk->block_min[block], chunk->block_max[block], chunk->block_sum[block],
+                STORE_BLOCK, bucket);
+    }
+    aggregate(chunk->values + end * STORE_BLOCK, last - end * STORE_BLOCK, bucket);
+}
+
+
+void store_init(struct store * store, size_t budget)
+{
+    memset(store, 0, sizeof(*store));
+    store->max_chunks = budget / sizeof(struct store_chunk);
+    if (store->max_chunks == 0) {
+        store->max_chunks = 1;
+    }
+}
+
+
+void store_destroy(struct store * store)
+{
+    struct store_chunk * chunk;
+
+    while ((chunk = store->oldest) != NULL) {
+        store->oldest = chunk->younger;
+        free(chunk);
+    }
+    store->newest = NULL;
+    store->chunks = 0;
+    store->series_count = 0;
+}
+
+
+static struct store_series * find(struct store * store, unsigned int sensor)
+{
+    unsigned int i;
+
+    for (i = 0; i < store->series_count; i++) {
+        if (store->series[i].sensor == sensor) {
+            return &store->series[i];
+        }
+    }
+    return NULL;
+}
+
+
+const struct store_series * store_find(const struct store * store, unsigned int sensor)
+{
+    return find((struct store *)store, sensor);
+}
+
+
+/**
+ * Returns an empty chunk, allocated while the budget allows it and
+ * recycled from the oldest one of the store afterwards.
+ */
+static struct store_chunk * new_chunk(struct store * store)
+{
+    struct store_chunk * chunk;
+    struct store_series * series;
+
+    if (store->chunks < store->max_chunks) {
+        chunk = malloc(sizeof(*chunk));
+        if (chunk == NULL) {
+            return NULL;
+        }
+        store->chunks++;
+    } else {
+        // The oldest chunk of the store is the oldest of its series
+        chunk = store->oldest;
+        store->oldest = chunk->younger;
+        if (store->oldest == NULL) {
+            store->newest = NULL;
+        }
+        series = chunk->series;
+        series->head = chunk->next;
+        if (series->head == NULL) {
+            series->tail = NULL;
+        }
+        series->count -= chunk->count;
+        store->evicted += chunk->count;
+    }
+
+    chunk->next = NULL;
+    chunk->younger = NULL;
+    chunk->count = 0;
+    chunk->min = INT64_MAX;
+    chunk->max = INT64_MIN;
+    chunk->sum = 0;
+
+    if (store->newest != NULL) {
+        store->newest->younger = chunk;
+    } else {
+        store->oldest = chunk;
+    }
+    store->newest = chunk;
+    return chunk;
+}
+
+
+int store_append(struct store * store, int64_t time, const struct sample * sample)
+{
+    struct store_series * series = find(store, sample->sensor);
+    struct store_chunk * chunk;
+    struct fixed value = sample->value;
+    unsigned int block;
+    int error;
+
+    if (series == NULL) {
+        if (store->series_count == STORE_MAX_SERIES) {
+            error = ENOSPC;
+            goto reject;
+        }
+        series = &store->series[store->series_count++];
+        memset(series, 0, sizeof(*series));
+        series->sensor = sample->sensor;
+        series->scale = value.scale;
+        series->last = INT64_MIN;
+    }
+
+    if (time < series->last) {
+        error = EINVAL;
+        goto reject;
+    }
+    if (value.scale != series->scale && fixed_rescale(&value, series->scale) < 0) {
+        error = ERANGE;
+        goto reject;
+    }
+
+    chunk = series->tail;
+    if (chunk == NULL || chunk->count == STORE_CHUNK) {
+        if ((chunk = new_chunk(store)) == NULL) {
+            error = ENOMEM;
+            goto reject;
+        }
+        chunk->series = series;
+        // Recycling may have emptied the series
+        if (series->tail != NULL) {
+            series->tail->next = chunk;
+        } else {
+            series->head = chunk;
+        }
+        series->tail = chunk;
+    }
+
+    block = chunk->count / STORE_BLOCK;
+    if (chunk->count % STORE_BLOCK == 0) {
+        chunk->block_min[block] = INT64_MAX;
+        chunk->block_max[block] = INT64_MIN;
+        chunk->block_sum[block] = 0;
+    }
+    chunk->times[chunk->count] = time;
+    chunk->values[chunk->count] = value.mantissa;
+    chunk->measures[chunk->count] = sample->measure;
+    chunk->count++;
+    if (value.mantissa < chunk->block_min[block]) {
+        chunk->block_min[block] = value.mantissa;
+    }
+    if (value.mantissa > chunk->block_max[block]) {
+        chunk->block_max[block] = value.mantissa;
+    }
+    chunk->block_sum[block] += value.mantissa;
+    if (value.mantissa < chunk->min) {
+        chunk->min = value.mantissa;
+    }
+    if (value.mantissa > chunk->max) {
+        chunk->max = value.mantissa;
+    }
+    chunk->sum += value.mantissa;
+
+    series->count++;
+    series->last = time;
+    store->appended++;
+    return 0;
+
+reject:
+    store->rejected++;
+    errno = error;
+    return -1;
+}
+
+
+size_t store_range(const struct store * store, unsigned int sensor, int64_t from, int64_t to,
+        int64_t * times, int64_t * values, size_t max)
+{
+    const struct store_series * series = store_find(store, sensor);
+    const struct store_chunk * chunk;
+    size_t copied = 0;
+    size_t first, last;
+
+    if (series == NULL) {
+        return 0;
+    }
+    for (chunk = series->head; chunk != NULL && copied < max; chunk = chunk->next) {
+        if (chunk->count == 0 || chunk->times[chunk->count - 1] < from) {
+            continue;
+        }
+        if (chunk->times[0] >= to) {
+            break;
+        }
+        first = lower_bound(chunk->times, chunk->count, from);
+        last = lower_bound(chunk->times, chunk->count, to);
+        if (last - first > max - copied) {
+            last = first + max - copied;
+        }
+        memcpy(times + copied, chunk->times + first, (last - first) * sizeof(*times));
+        memcpy(values + copied, chunk->values + first, (last - first) * sizeof(*values));
+        copied += last - first;
+    }
+    return copied;
+}
+
+
+size_t store_scan(const struct store * store, unsigned int sensor, int64_t from, int64_t to,
+        int (*visit)(int64_t time, int64_t value, uint32_t measure, void * arg), void * arg)
+{
+    const struct store_series * series = store_find(store, sensor);
+    const struct store_chunk * chunk;
+    size_t visited = 0;
+    size_t i;
+
+    if (series == NULL) {
+        return 0;
+    }
+    for (chunk = series->head; chunk != NULL; chunk = chunk->next) {
+        if (chunk->count == 0 || chunk->times[chunk->count - 1] < from) {
+            continue;
+        }
+        if (chunk->times[0] >= to) {
+            break;
+        }
+        for (i = lower_bound(chunk->times, chunk->count, from); i < chunk->count && chunk->times[i] < to; i++) {
+            visited++;
+            if (visit(chunk->times[i], chunk->values[i], chunk->measures[i], arg) != 0) {
+                return visited;
+            }
+        }
+    }
+    return visited;
+}
+
+
+size_t store_last(const struct store * store, unsigned int sensor, size_t n, int64_t * times, int64_t * values)
+{
+    const struct store_series * series = store_find(store, sensor);
+    const struct store_chunk * chunk;
+    size_t skip, first, copied = 0;
+
+    if (series == NULL) {
+        return 0;
+    }
+    skip = series->count > n ? series->count - n : 0;
+    for (chunk = series->head; chunk != NULL; chunk = chunk->next) {
+        if (skip >= chunk->count) {
+            skip -= chunk->count;
+            continue;
+        }
+        first = skip;
+        skip = 0;
+        memcpy(times + copied, chunk->times + first, (chunk->count - first) * sizeof(*times));
+        memcpy(values + copied, chunk->values + first, (chunk->count - first) * sizeof(*values));
+        copied += chunk->count - first;
+    }
+    return copied;
+}
+
+
+size_t store_downsample(const struct store * store, unsigned int sensor, int64_t from, int64_t to,
+        int64_t width, struct store_bucket * buckets, size_t max)
+{
+    const struct store_series * series = store_find(store, sensor);
+    const struct store_chunk * chunk;
+    size_t count, index, first, last;
+    int64_t end;
+    size_t i;
+
+    if (width <= 0 || to <= from) {
+        return 0;
+    }
+    count = (to - from + width - 1) / width;
+    if (count > max) {
+        count = max;
+        to = from + (int64_t)count * width;
+    }
+    for (i = 0; i < count; i++) {
+        buckets[i].start = from + (int64_t)i * width;
+        buckets[i].count = 0;
+        buckets[i].min = INT64_MAX;
+        buckets[i].max = INT64_MIN;
+        buckets[i].sum = 0;
+    }
+    if (series == NULL) {
+        return count;
+    }
+
+    for (chunk = series->head; chunk != NULL; chunk = chunk->next) {
+        if (chunk->count == 0 || chunk->times[chunk->count - 1] < from) {
+            continue;
+        }
+        if (chunk->times[0] >= to) {
+            break;
+        }
+
+        // Wholly inside a bucket, the summary does
+        if (chunk->times[0] >= from && chunk->times[chunk->count - 1] < to) {
+            index = (chunk->times[0] - from) / width;
+            if ((size_t)((chunk->times[chunk->count - 1] - from) / width) == index) {
+                merge(chunk->min, chunk->max, chunk->sum, chunk->count, &buckets[index]);
+                continue;
+            }
+        }
+
+        // Otherwise the column is cut at every bucket boundary
+        first = lower_bound(chunk->times, chunk->count, from);
+        while (first < chunk->count && chunk->times[first] < to) {
+            index = (chunk->times[first] - from) / width;
+            end = buckets[index].start + width;
+            last = first + lower_bound(chunk->times + first, chunk->count - first, end);
+            aggregate_slice(chunk, first, last, &buckets[index]);
+            first = last;
+        }
+    }
+    return count;
+}
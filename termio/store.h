@@ -0,0 +1,136 @@
+#ifndef STORE_H
+#define STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parser.h"
+
+
+/**
+ * In-memory store of the recent samples, one series per sensor. A series
+ * is a list of chunks holding separate time, value and measure columns,
+ * along with the min, max and sum of their values, as a whole and per
+ * block of STORE_BLOCK samples: aggregation queries only scan the values
+ * of the blocks cut by a bucket boundary, the others are summed up from
+ * their summary.
+ *
+ * Chunks come from a memory budget shared by every series. Once it is
+ * spent, the oldest chunk of the whole store is recycled.
+ *
+ * Values are fixed-point mantissas, at the scale of the first sample of
+ * their series (later ones are rescaled to it). Times are in us and must
+ * not go backwards within a series.
+ */
+
+#define STORE_CHUNK 1024
+#define STORE_BLOCK 64
+#define STORE_BLOCKS (STORE_CHUNK / STORE_BLOCK)
+#define STORE_MAX_SERIES 64
+
+// Default memory budget
+#define STORE_BUDGET (16 << 20)
+
+
+struct store_series;
+
+struct store_chunk {
+    struct store_chunk * next;      // Next of the series
+    struct store_chunk * younger;   // Next allocated, across the store
+    struct store_series * series;
+    unsigned int count;
+    int64_t min, max, sum;
+    int64_t block_min[STORE_BLOCKS];
+    int64_t block_max[STORE_BLOCKS];
+    int64_t block_sum[STORE_BLOCKS];
+    int64_t times[STORE_CHUNK];
+    int64_t values[STORE_CHUNK];
+    uint32_t measures[STORE_CHUNK];
+};
+
+struct store_series {
+    unsigned int sensor;
+    int scale;
+    struct store_chunk * head;      // Oldest
+    struct store_chunk * tail;      // Being filled
+    size_t count;
+    int64_t last;                   // Time of the last sample
+};
+
+/**
+ * Aggregate of the samples in [start, start + width).
+ */
+struct store_bucket {
+    int64_t start;
+    size_t count;
+    int64_t min, max, sum;          // Undefined when count is 0
+};
+
+struct store {
+    struct store_series series[STORE_MAX_SERIES];
+    unsigned int series_count;
+    struct store_chunk * oldest;
+    struct store_chunk * newest;
+    size_t chunks;
+    size_t max_chunks;
+
+    unsigned long long appended;
+    unsigned long long evicted;     // Samples recycled with their chunk
+    unsigned long rejected;
+};
+
+
+/**
+ * Initializes an empty store of up to budget bytes of chunks (at least
+ * one).
+ */
+void store_init(struct store * store, size_t budget);
+
+/**
+ * Frees every chunk, leaving the store empty but its counters.
+ */
+void store_destroy(struct store * store);
+
+/**
+ * Appends a sample received at time (us). Returns -1 with errno set,
+ * counting the sample as rejected, if it goes back in time (EINVAL), does
+ * not fit the scale of its series (ERANGE), needs a new series when there
+ * is no room left (ENOSPC), or a chunk could not be allocated.
+ */
+int store_append(struct store * store, int64_t time, const struct sample * sample);
+
+/**
+ * Returns the series of a sensor, or NULL.
+ */
+const struct store_series * store_find(const struct store * store, unsigned int sensor);
+
+/**
+ * Copies the times and values of the samples of the sensor in [from, to),
+ * up to max of them. Returns how many were copied.
+ */
+size_t store_range(const struct store * store, unsigned int sensor, int64_t from, int64_t to,
+        int64_t * times, int64_t * values, size_t max);
+
+/**
+ * Calls visit with the time, value and measure of every sample of the
+ * sensor in [from, to), oldest first, until it returns non zero. Returns
+ * how many samples were visited.
+ */
+size_t store_scan(const struct store * store, unsigned int sensor, int64_t from, int64_t to,
+        int (*visit)(int64_t time, int64_t value, uint32_t measure, void * arg), void * arg);
+
+/**
+ * Copies the times and values of the last n samples of the sensor, oldest
+ * first. Returns how many were copied.
+ */
+size_t store_last(const struct store * store, unsigned int sensor, size_t n, int64_t * times, int64_t * values);
+
+/**
+ * Aggregates the samples of the sensor in [from, to) into consecutive
+ * buckets of width us, up to max of them. Returns the number of buckets
+ * filled, empty ones included.
+ */
+size_t store_downsample(const struct store * store, unsigned int sensor, int64_t from, int64_t to,
+        int64_t width, struct store_bucket * buckets, size_t max);
+
+#endif
@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <termios.h>
+#include <sys/time.h>
+#include <sys/timerfd.h>
+
+#include "acquire.h"
+
+
+// Sleep between two attempts of the spinning strategy (ms)
+#define INTRA_TIMEOUT 20
+
+
+/**
+ * Result of a readv() on a blocking line. A signal interrupting it is
+ * reported, anything else but data is fatal.
+ */
+static enum read_status blocking_result(struct line * line, ssize_t size)
+{
+    if (size < 0 && errno == EINTR) {
+        return READ_INTERRUPTED;
+    }
+    CHECKERR(size, "Failed to read data from %s", line->path);
+    return READ_OK;
+}
+
+
+/**
+ * Canonical mode, blocking reads returning one line at a time. There is
+ * no timeout: a lost response stalls the line until a signal interrupts
+ * the read.
+ */
+static enum read_status canon_read(struct line * line)
+{
+    enum read_status status = line_idle(line, 0);
+
+    if (status == READ_INTERRUPTED) {
+        return status;
+    }
+    line->stats.waits++;
+    return blocking_result(line, line_readv(line));
+}
+
+static const struct strategy canon = {
+    "canon", "canonical mode, blocking read, no timeout",
+    0, NULL, NULL, canon_read, NULL,
+};
+
+
+/**
+ * Raw mode, the timeout being left to the terminal driver: with VMIN = 0
+ * a read returns nothing once VTIME tenths of a second passed without a
+ * byte.
+ */
+static void vtime_configure(struct line * line, struct termios * conf)
+{
+    int tenths = line->timeout / 100;
+
+    conf->c_lflag = 0;
+    if (line->timeout == 0) {
+        conf->c_cc[VMIN] = 1;
+        conf->c_cc[VTIME] = 0;
+        return;
+    }
+    conf->c_cc[VMIN] = 0;
+    conf->c_cc[VTIME] = tenths < 1 ? 1 : tenths > 255 ? 255 : tenths;
+}
+
+static enum read_status vtime_read(struct line * line)
+{
+    enum read_status status = line_idle(line, 1);
+    ssize_t size;
+
+    if (status != READ_OK) {
+        return status;
+    }
+    line->stats.waits++;
+    size = line_readv(line);
+    if (size == 0) {
+        return READ_TIMEOUT;
+    }
+    return blocking_result(line, size);
+}
+
+static const struct strategy vtime = {
+    "vtime", "raw mode, VMIN/VTIME inter-byte timeout",
+    0, vtime_configure, NULL, vtime_read, NULL,
+};
+
+
+/**
+ * Nonblocking reads, sleeping INTRA_TIMEOUT ms whenever nothing is
+ * available. Simple but late by up to INTRA_TIMEOUT on every response.
+ */
+static enum read_status spin_read(struct line * line)
+{
+    ssize_t size;
+
+    while (1) {
+        size = line_readv(line);
+        if (size >= 0) {
+            return READ_OK;
+        }
+        if (errno == EINTR) {
+            return READ_INTERRUPTED;
+        }
+        if (errno != EAGAIN) {
+            CHECKERR(size, "Failed to read data from %s", line->path);
+        }
+        if (line_remaining(line) == 0) {
+            return READ_TIMEOUT;
+        }
+        line_tick(line);
+        line->stats.waits++;
+        if (usleep(INTRA_TIMEOUT * 1000) < 0) {
+            return READ_INTERRUPTED;
+        }
+    }
+}
+
+static const struct strategy spin = {
+    "spin", "nonblocking reads, sleeping 20ms between attempts",
+    O_NONBLOCK, NULL, NULL, spin_read, NULL,
+};
+
+
+/**
+ * Nonblocking reads, sleeping in poll() until data arrives or the
+ * deadline passes.
+ */
+static enum read_status poll_read(struct line * line)
+{
+    enum read_status status;
+    struct pollfd pfd;
+    ssize_t size;
+    int ret;
+
+    pfd.fd = line->fd;
+    pfd.events = POLLIN;
+
+    while (1) {
+        size = line_readv(line);
+        if (size >= 0) {
+            return READ_OK;
+        }
+        if (errno == EINTR) {
+            return READ_INTERRUPTED;
+        }
+        if (errno != EAGAIN) {
+            CHECKERR(size, "Failed to read data from %s", line->path);
+        }
+        if (line_remaining(line) == 0) {
+            return READ_TIMEOUT;
+        }
+        status = line_idle(line, 1);
+        if (status != READ_OK) {
+            return status;
+        }
+
+        line->stats.waits++;
+        ret = poll(&pfd, 1, line_remaining(line));
+        if (ret < 0 && errno == EINTR) {
+            return READ_INTERRUPTED;
+        }
+        CHECKERR(ret, "Failed to wait for data (fd=%d)", line->fd);
+        if (ret == 0) {
+            return READ_TIMEOUT;
+        }
+    }
+}
+
+static const struct strategy poll_strategy = {
+    "poll", "nonblocking reads, poll() until the deadline",
+    O_NONBLOCK, NULL, NULL, poll_read, NULL,
+};
+
+
+/**
+ * Blocking reads interrupted by SIGALRM when the deadline passes.
+ */
+static volatile sig_atomic_t alarm_fired = 0;
+
+static void on_alarm()
+{
+    alarm_fired = 1;
+}
+
+static void signal_setup(struct line * line)
+{
+    struct sigaction sa;
+
+    (void)line;
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = on_alarm;
+    sigaction(SIGALRM, &sa, NULL);
+}
+
+static void set_alarm(int timeout)
+{
+    struct itimerval ti;
+
+    memset(&ti, 0, sizeof(ti));
+    ti.it_value.tv_sec = timeout / 1000;
+    ti.it_value.tv_usec = (timeout % 1000) * 1000;
+    setitimer(ITIMER_REAL, &ti, NULL);
+}
+
+static enum read_status signal_read(struct line * line)
+{
+    enum read_status status = line_idle(line, 1);
+    int remaining = line_remaining(line);
+    ssize_t size;
+
+    if (status != READ_OK) {
+        return status;
+    }
+    if (remaining == 0) {
+        return READ_TIMEOUT;
+    }
+
+    alarm_fired = 0;
+    if (remaining > 0) {
+        set_alarm(remaining);
+    }
+    line->stats.waits++;
+    size = line_readv(line);
+    if (remaining > 0) {
+        set_alarm(0);
+    }
+
+    if (size < 0 && errno == EINTR && alarm_fired) {
+        return READ_TIMEOUT;
+    }
+    return blocking_result(line, size);
+}
+
+static void signal_teardown(struct line * line)
+{
+    (void)line;
+    signal(SIGALRM, SIG_DFL);
+}
+
+static const struct strategy signal_strategy = {
+    "signal", "canonical mode, blocking read interrupted by SIGALRM",
+    0, NULL, signal_setup, signal_read, signal_teardown,
+};
+
+
+/**
+ * Nonblocking reads, waiting in poll() on both the line and a timerfd
+ * armed at the absolute deadline, no signal involved.
+ */
+static void timerfd_setup(struct line * line)
+{
+    line->private_fd = timerfd_create(CLOCK_MONOTONIC, 0);
+    CHECKERR(line->private_fd, "Failed to create timer for %s", line->path);
+}
+
+static void arm_timer(struct line * line)
+{
+    struct itimerspec ts;
+
+    memset(&ts, 0, sizeof(ts));
+    if (line->deadline >= 0) {
+        ts.it_value.tv_sec = line->deadline / 1000000;
+        ts.it_value.tv_nsec = (line->deadline % 1000000) * 1000;
+    }
+    CHECKERR(timerfd_settime(line->private_fd, TFD_TIMER_ABSTIME, &ts, NULL),
+            "Couldn't arm timer (fd=%d)", line->private_fd);
+}
+
+static enum read_status timerfd_read(struct line * line)
+{
+    enum read_status status;
+    struct pollfd fds[2];
+    uint64_t expirations;
+    ssize_t size;
+    int ret;
+
+    fds[0].fd = line->fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = line->private_fd;
+    fds[1].events = POLLIN;
+
+    while (1) {
+        size = line_readv(line);
+        if (size >= 0) {
+            return READ_OK;
+        }
+        if (errno == EINTR) {
+            return READ_INTERRUPTED;
+        }
+        if (errno != EAGAIN) {
+            CHECKERR(size, "Failed to read data from %s", line->path);
+        }
+
+        status = line_idle(line, 1);
+        if (status != READ_OK) {
+            return status;
+        }
+
+        line->stats.waits++;
+        arm_timer(line);
+        ret = poll(fds, 2, -1);
+        if (ret < 0 && errno == EINTR) {
+            return READ_INTERRUPTED;
+        }
+        CHECKERR(ret, "Failed to wait for data (fd=%d)", line->fd);
+
+        // Data wins over a timer which expired at the same time
+        if (!(fds[0].revents & (POLLIN | POLLERR | POLLHUP))) {
+            CHECKERR(read(line->private_fd, &expirations, sizeof(expirations)),
+                    "Couldn't read timer (fd=%d)", line->private_fd);
+            return READ_TIMEOUT;
+        }
+    }
+}
+
+static void timerfd_teardown(struct line * line)
+{
+    close(line->private_fd);
+}
+
+static const struct strategy timerfd = {
+    "timerfd", "nonblocking reads, poll() on the line and a timerfd",
+    O_NONBLOCK, NULL, timerfd_setup, timerfd_read, timerfd_teardown,
+};
+
+
+const struct strategy * const strategies[] = {
+    &canon,
+    &vtime,
+    &spin,
+    &poll_strategy,
+    &signal_strategy,
+    &timerfd,
+    NULL,
+};
@@ -0,0 +1,225 @@
+#include <stddef.h>
+
+#include "wheel.h"
+
+
+#define LEVEL_SHIFT(level) (WHEEL_BITS * (level))
+
+
+static void list_init(struct wheel_link * head)
+{
+    head->next = head;
+    head->prev = head;
+}
+
+
+static void list_add(struct wheel_link * head, struct wheel_link * link)
+{
+    link->prev = head->prev;
+    link->next = head;
+    head->prev->next = link;
+    head->prev = link;
+}
+
+
+static void list_del(struct wheel_link * link)
+{
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    link->next = NULL;
+    link->prev = NULL;
+}
+
+
+/**
+ * Moves the content of a slot to head, leaving the slot empty.
+ */
+static void list_take(struct wheel_link * slot, struct wheel_link * head)
+{
+    if (slot->next == slot) {
+        list_init(head);
+        return;
+    }
+    head->next = slot->next;
+    head->prev = slot->prev;
+    head->next->prev = head;
+    head->prev->next = head;
+    list_init(slot);
+}
+
+
+void wheel_init(struct wheel * wheel, unsigned long long now)
+{
+    int level, slot;
+
+    wheel->now = now;
+    wheel->count = 0;
+
+    for (level = 0; level < WHEEL_LEVELS; level++) {
+        for (slot = 0; slot < WHEEL_SLOTS; slot++) {
+            list_init(&wheel->slots[level][slot]);
+        }
+    }
+}
+
+
+void timer_init(struct timer * timer, void (*expire)(struct timer *))
+{
+    timer->link.next = NULL;
+    timer->link.prev = NULL;
+    timer->expires = 0;
+    timer->expire = expire;
+}
+
+
+int timer_pending(struct timer * timer)
+{
+    return timer->link.next != NULL;
+}
+
+
+/**
+ * Links the timer in the slot matching its distance from the current tick.
+ */
+static void place(struct wheel * wheel, struct timer * timer)
+{
+    unsigned long long expires = timer->expires;
+    unsigned long long delta;
+    int level = 0;
+
+    if (expires < wheel->now) {
+        expires = wheel->now;
+    }
+
+    delta = expires - wheel->now;
+    if (delta >= WHEEL_RANGE) {
+        delta = WHEEL_RANGE - 1;
+        expires = wheel->now + delta;
+    }
+
+    while (delta >= 1ULL << LEVEL_SHIFT(level + 1)) {
+        level++;
+    }
+
+    list_add(&wheel->slots[level][(expires >> LEVEL_SHIFT(level)) & WHEEL_MASK], &timer->link);
+}
+
+
+void wheel_arm(struct wheel * wheel, struct timer * timer, unsigned long long expires)
+{
+    wheel_cancel(wheel, timer);
+    timer->expires = expires;
+    place(wheel, timer);
+    wheel->count++;
+}
+
+
+void wheel_cancel(struct wheel * wheel, struct timer * timer)
+{
+    if (timer_pending(timer)) {
+        list_del(&timer->link);
+        wheel->count--;
+    }
+}
+
+
+/**
+ * Redistributes the timers of a slot on the lower levels.
+ */
+static void cascade(struct wheel * wheel, int level, int slot)
+{
+    struct wheel_link head;
+    struct wheel_link * link;
+
+    list_take(&wheel->slots[level][slot], &head);
+
+    while (head.next != &head) {
+        link = head.next;
+        list_del(link);
+        place(wheel, (struct timer *)link);
+    }
+}
+
+
+void wheel_advance(struct wheel * wheel, unsigned long long now)
+{
+    struct wheel_link expired;
+    struct wheel_link * link;
+    int index, level, slot;
+
+    if (wheel->count == 0) {
+        // Nothing to expire nor to cascade, jump straight to now
+        if (now >= wheel->now) {
+            wheel->now = now + 1;
+        }
+        return;
+    }
+
+    while (wheel->now <= now) {
+        index = wheel->now & WHEEL_MASK;
+
+        // Once per revolution, bring the next slot of the upper levels down
+        if (index == 0) {
+            for (level = 1; level < WHEEL_LEVELS; level++) {
+                slot = (wheel->now >> LEVEL_SHIFT(level)) & WHEEL_MASK;
+                cascade(wheel, level, slot);
+                if (slot != 0) {
+                    break;
+                }
+            }
+        }
+
+        list_take(&wheel->slots[0][index], &expired);
+        wheel->now++;
+
+        while (expired.next != &expired) {
+            link = expired.next;
+            list_del(link);
+            wheel->count--;
+            ((struct timer *)link)->expire((struct timer *)link);
+        }
+    }
+}
+
+
+long long wheel_next(struct wheel * wheel)
+{
+    struct wheel_link * slot;
+    unsigned long long next = 0;
+    unsigned long long when;
+    unsigned long long span;
+    int found = 0;
+    int level, i;
+
+    if (wheel->count == 0) {
+        return -1;
+    }
+
+    // Level 0 holds timers expiring exactly at their slot's tick
+    for (i = 0; i < WHEEL_SLOTS; i++) {
+        slot = &wheel->slots[0][(wheel->now + i) & WHEEL_MASK];
+        if (slot->next != slot) {
+            return wheel->now + i;
+        }
+    }
+
+    // Upper levels only tell when their timers get cascaded down, which is
+    // never later than when they expire
+    for (level = 1; level < WHEEL_LEVELS; level++) {
+        span = 1ULL << LEVEL_SHIFT(level);
+        when = (wheel->now + span - 1) & ~(span - 1);
+
+        for (i = 0; i < WHEEL_SLOTS; i++, when += span) {
+            slot = &wheel->slots[level][(when >> LEVEL_SHIFT(level)) & WHEEL_MASK];
+            if (slot->next != slot) {
+                if (!found || when < next) {
+                    next = when;
+                    found = 1;
+                }
+                break;
+            }
+        }
+    }
+
+    return found ? (long long)next : (long long)wheel->now;
+}
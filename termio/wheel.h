@@ -0,0 +1,84 @@
+#ifndef WHEEL_H
+#define WHEEL_H
+
+
+/**
+ * Hashed hierarchical timing wheel: WHEEL_LEVELS wheels of WHEEL_SLOTS
+ * slots each, every level being WHEEL_SLOTS times coarser than the one
+ * below. Arming and cancelling a timer are O(1), expiring costs O(1) per
+ * timer plus a cascade to the lower level once per revolution.
+ *
+ * Time is counted in ticks, the caller chooses the unit (milliseconds in
+ * the acquisition loop). Timers further away than WHEEL_RANGE ticks are
+ * parked on the last level and cascaded until they are in range.
+ */
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_RANGE (1ULL << (WHEEL_BITS * WHEEL_LEVELS))
+
+
+struct wheel_link {
+    struct wheel_link * next;
+    struct wheel_link * prev;
+};
+
+/**
+ * A timer, meant to be embedded as the first member of the structure it
+ * times out so that the expire callback can get back to it.
+ */
+struct timer {
+    struct wheel_link link;
+    unsigned long long expires;
+    void (*expire)(struct timer * timer);
+};
+
+struct wheel {
+    unsigned long long now;     // Next tick to be processed
+    unsigned int count;         // Armed timers
+    struct wheel_link slots[WHEEL_LEVELS][WHEEL_SLOTS];
+};
+
+
+/**
+ * Initializes an empty wheel, now being the current tick.
+ */
+void wheel_init(struct wheel * wheel, unsigned long long now);
+
+/**
+ * Initializes a timer which is not armed yet.
+ */
+void timer_init(struct timer * timer, void (*expire)(struct timer *));
+
+/**
+ * Returns whether the timer is armed.
+ */
+int timer_pending(struct timer * timer);
+
+/**
+ * Arms (or re-arms) a timer to expire at the absolute tick expires. A tick
+ * in the past expires at the next wheel_advance().
+ */
+void wheel_arm(struct wheel * wheel, struct timer * timer, unsigned long long expires);
+
+/**
+ * Disarms a timer, does nothing if it is not armed.
+ */
+void wheel_cancel(struct wheel * wheel, struct timer * timer);
+
+/**
+ * Runs the expire callback of every timer due up to tick now included.
+ * Callbacks may arm and cancel timers.
+ */
+void wheel_advance(struct wheel * wheel, unsigned long long now);
+
+/**
+ * Returns a tick before which no timer expires, exact when the earliest
+ * timer is less than WHEEL_SLOTS ticks away, or -1 if no timer is armed.
+ * Meant to compute the timeout of poll() and friends.
+ */
+long long wheel_next(struct wheel * wheel);
+
+#endif